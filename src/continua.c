@@ -0,0 +1,186 @@
+/*
+  This file is part of JURASSIC.
+  
+  JURASSIC is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  JURASSIC is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with JURASSIC. If not, see <http://www.gnu.org/licenses/>.
+  
+  Copyright (C) 2003-2025 Forschungszentrum Juelich GmbH
+*/
+
+
+/*! 
+  \file
+  Compare and benchmark exact and tabulated continuum absorption.
+*/
+
+#include "jurassic.h"
+
+/* ------------------------------------------------------------
+   Functions...
+   ------------------------------------------------------------ */
+
+/*! Compute absorption coefficient of continua without look-up tables. */
+void continua_exact(
+  const ctl_t * ctl,
+  const los_t * los,
+  const int ip,
+  double *beta);
+
+/* ------------------------------------------------------------
+   Main...
+   ------------------------------------------------------------ */
+
+int main(
+  int argc,
+  char *argv[]) {
+
+  static atm_t atm;
+  static ctl_t ctl;
+
+  static double beta0[NLOS][ND];
+
+  FILE *out;
+
+  los_t *los;
+
+  tbl_t *tbl;
+
+  /* Check arguments... */
+  if (argc < 4)
+    ERRMSG("Give parameters: <ctl> <atm> <ctm.tab>");
+
+  /* Read control parameters... */
+  read_ctl(argc, argv, &ctl);
+  ctl.ctm_tbl = 1;
+  const int nrep = (int) scan_ctl(argc, argv, "NREP", -1, "1000", NULL);
+
+  /* Read atmospheric data... */
+  read_atm(NULL, argv[2], &ctl, &atm);
+
+  /* Allocate... */
+  ALLOC(los, los_t, 1);
+  ALLOC(tbl, tbl_t, 1);
+
+  /* Initialize continuum table... */
+  init_continua(&ctl, tbl);
+
+  /* Set up LOS with 1 km segments at the atmospheric data points... */
+  if (atm.np > NLOS)
+    ERRMSG("Too many data points!");
+  los->np = atm.np;
+  for (int ip = 0; ip < los->np; ip++) {
+    los->z[ip] = atm.z[ip];
+    los->p[ip] = atm.p[ip];
+    los->t[ip] = atm.t[ip];
+    los->ds[ip] = 1;
+    for (int ig = 0; ig < ctl.ng; ig++) {
+      los->q[ip][ig] = atm.q[ig][ip];
+      los->u[ip][ig] = 10 * los->q[ip][ig] * los->p[ip]
+	/ (KB * los->t[ip]) * los->ds[ip];
+    }
+    for (int id = 0; id < ctl.nd; id++)
+      los->k[ip][id] = 0;
+  }
+
+  /* Benchmark exact continua... */
+  double t0 = omp_get_wtime();
+  for (int irep = 0; irep < nrep; irep++)
+    for (int ip = 0; ip < los->np; ip++)
+      continua_exact(&ctl, los, ip, beta0[ip]);
+  const double dt0 = (omp_get_wtime() - t0) / (nrep * los->np);
+
+  /* Benchmark tabulated continua... */
+  t0 = omp_get_wtime();
+  for (int irep = 0; irep < nrep; irep++)
+    formod_continua(&ctl, tbl, los);
+  const double dt1 = (omp_get_wtime() - t0) / (nrep * los->np);
+
+  /* Write info... */
+  LOG(1, "Continuum cost per LOS point: exact= %g us | tabulated= %g us"
+      " | speedup= %g", 1e6 * dt0, 1e6 * dt1, dt0 / dt1);
+
+  /* Create file... */
+  LOG(1, "Write continuum data: %s", argv[3]);
+  if (!(out = fopen(argv[3], "w")))
+    ERRMSG("Cannot create file!");
+
+  /* Write header... */
+  fprintf(out,
+	  "# $1 = altitude [km]\n"
+	  "# $2 = pressure [hPa]\n" "# $3 = temperature [K]\n");
+  for (int id = 0; id < ctl.nd; id++)
+    fprintf(out, "# $%d = continuum absorption, exact (%.4f cm^-1) [km^-1]\n"
+	    "# $%d = continuum absorption, tabulated (%.4f cm^-1) [km^-1]\n",
+	    4 + 2 * id, ctl.nu[id], 5 + 2 * id, ctl.nu[id]);
+  fprintf(out, "\n");
+
+  /* Write data... */
+  double maxerr = 0;
+  for (int ip = 0; ip < los->np; ip++) {
+    fprintf(out, "%g %g %g", los->z[ip], los->p[ip], los->t[ip]);
+    for (int id = 0; id < ctl.nd; id++) {
+      fprintf(out, " %g %g", beta0[ip][id], los->beta[ip][id]);
+      if (beta0[ip][id] > 0)
+	maxerr = MAX(maxerr, fabs(los->beta[ip][id] / beta0[ip][id] - 1));
+    }
+    fprintf(out, "\n");
+  }
+
+  /* Close file... */
+  fclose(out);
+
+  /* Write info... */
+  LOG(1, "Maximum relative difference: %g", maxerr);
+
+  /* Free... */
+  free(los);
+  free(tbl);
+
+  return EXIT_SUCCESS;
+}
+
+/*****************************************************************************/
+
+void continua_exact(
+  const ctl_t *ctl,
+  const los_t *los,
+  const int ip,
+  double *beta) {
+
+  /* Extinction... */
+  for (int id = 0; id < ctl->nd; id++)
+    beta[id] = los->k[ip][id];
+
+  /* CO2 continuum... */
+  if (ctl->ctm_co2 && ctl->ig_co2 >= 0)
+    for (int id = 0; id < ctl->nd; id++)
+      beta[id] += ctmco2(ctl->nu[id], los->p[ip], los->t[ip],
+			 los->u[ip][ctl->ig_co2]) / los->ds[ip];
+
+  /* H2O continuum... */
+  if (ctl->ctm_h2o && ctl->ig_h2o >= 0)
+    for (int id = 0; id < ctl->nd; id++)
+      beta[id] += ctmh2o(ctl->nu[id], los->p[ip], los->t[ip],
+			 los->q[ip][ctl->ig_h2o], los->u[ip][ctl->ig_h2o])
+	/ los->ds[ip];
+
+  /* N2 continuum... */
+  if (ctl->ctm_n2)
+    for (int id = 0; id < ctl->nd; id++)
+      beta[id] += ctmn2(ctl->nu[id], los->p[ip], los->t[ip]);
+
+  /* O2 continuum... */
+  if (ctl->ctm_o2)
+    for (int id = 0; id < ctl->nd; id++)
+      beta[id] += ctmo2(ctl->nu[id], los->p[ip], los->t[ip]);
+}
@@ -44,11 +44,16 @@ int main(
 
   /* Read atmospheric data... */
   read_atm(NULL, argv[2], &ctl, &atm_in);
+
+  /* Read interpolation points (not on a 3D grid)... */
+  const int atm3d = ctl.atm3d;
+  ctl.atm3d = 0;
   read_atm(NULL, argv[3], &ctl, &atm_pts);
+  ctl.atm3d = atm3d;
 
   /* Interpolate atmospheric data... */
   for (int ip = 0; ip < atm_pts.np; ip++) {
-    intpol_atm(&ctl, &atm_in, atm_pts.z[ip],
+    intpol_atm(&ctl, &atm_in, atm_pts.z[ip], atm_pts.lon[ip], atm_pts.lat[ip],
 	       &atm_pts.p[ip], &atm_pts.t[ip], q, k);
     for (int ig = 0; ig < ctl.ng; ig++)
       atm_pts.q[ig][ip] = q[ig];
@@ -773,14 +773,8 @@ void climatology(
     2e-10, 2e-10, 2e-10, 2e-10, 2e-10, 2e-10
   };
 
-  static int ig_co2 = -999;
-
   double *q[NG] = { NULL };
 
-  /* Find emitter index of CO2... */
-  if (ig_co2 == -999)
-    ig_co2 = find_emitter(ctl, "CO2");
-
   /* Identify variable... */
   for (int ig = 0; ig < ctl->ng; ig++) {
     q[ig] = NULL;
@@ -861,8 +855,8 @@ void climatology(
 	atm->q[ig][ip] = 0;
 
     /* Set CO2... */
-    if (ig_co2 >= 0)
-      atm->q[ig_co2][ip] =
+    if (ctl->ig_co2 >= 0)
+      atm->q[ctl->ig_co2][ip] =
 	371.789948e-6 + 2.026214e-6 * (atm->time[ip] - 63158400.) / 31557600.;
 
     /* Set extinction to zero... */
@@ -2948,6 +2942,13 @@ void copy_atm(
   atm_dest->sft = atm_src->sft;
   for (int isf = 0; isf < ctl->nsf; isf++)
     atm_dest->sfeps[isf] = atm_src->sfeps[isf];
+  atm_dest->nlon = atm_src->nlon;
+  atm_dest->nlat = atm_src->nlat;
+  atm_dest->nz = atm_src->nz;
+  atm_dest->lon0 = atm_src->lon0;
+  atm_dest->dlon = atm_src->dlon;
+  atm_dest->lat0 = atm_src->lat0;
+  atm_dest->dlat = atm_src->dlat;
 
   /* Initialize... */
   if (init)
@@ -3028,6 +3029,10 @@ void formod(
   atm_t *atm,
   obs_t *obs) {
 
+  static const tbl_t *tbl;
+
+  static int init = 0;
+
   int *mask;
 
   /* Allocate... */
@@ -3043,9 +3048,33 @@ void formod(
   hydrostatic(ctl, atm);
 
   /* CGA or EGA forward model... */
-  if (ctl->formod == 0 || ctl->formod == 1)
-    for (int ir = 0; ir < obs->nr; ir++)
-      formod_pencil(ctl, atm, obs, ir);
+  if (ctl->formod == 0 || ctl->formod == 1) {
+
+    /* Initialize look-up tables... */
+#pragma omp critical (formod_init)
+    if (!init) {
+      tbl = tbl_open(ctl);
+      init = 1;
+    }
+
+    /* Check atmospheric data... */
+    if (ctl->raygeom != 0 && (atm->nlon > 1 || atm->nlat > 1))
+      ERRMSG("RAYGEOM > 0 requires 1D atmospheric data!");
+
+    /* Spherical shells... */
+    if (ctl->raygeom == 1)
+      formod_shells(ctl, tbl, atm, obs);
+
+    /* Plane-parallel nadir... */
+    else if (ctl->raygeom == 2 || ctl->raygeom == 3)
+      formod_nadir(ctl, tbl, atm, obs);
+
+    /* Pencil beams... */
+    else
+      for (int ir = 0; ir < obs->nr; ir += ctl->raybatch)
+	formod_pencil(ctl, tbl, atm, obs, ir,
+		      MIN(ctl->raybatch, obs->nr - ir));
+  }
 
   /* Call RFM... */
   else if (ctl->formod == 2)
@@ -3074,46 +3103,71 @@ void formod(
 
 void formod_continua(
   const ctl_t *ctl,
-  const los_t *los,
-  const int ip,
-  double *beta) {
-
-  static int ig_co2 = -999, ig_h2o = -999;
-
-  /* Extinction... */
-  for (int id = 0; id < ctl->nd; id++)
-    beta[id] = los->k[ip][id];
+  const tbl_t *tbl,
+  los_t *los) {
 
-  /* CO2 continuum... */
-  if (ctl->ctm_co2) {
-    if (ig_co2 == -999)
-      ig_co2 = find_emitter(ctl, "CO2");
-    if (ig_co2 >= 0)
-      for (int id = 0; id < ctl->nd; id++)
-	beta[id] += ctmco2(ctl->nu[id], los->p[ip], los->t[ip],
-			   los->u[ip][ig_co2]) / los->ds[ip];
-  }
+  /* Loop over LOS points... */
+  for (int ip = 0; ip < los->np; ip++) {
 
-  /* H2O continuum... */
-  if (ctl->ctm_h2o) {
-    if (ig_h2o == -999)
-      ig_h2o = find_emitter(ctl, "H2O");
-    if (ig_h2o >= 0)
+    /* Exact continua... */
+    if (!ctl->ctm_tbl) {
+      double *beta = los->beta[ip];
       for (int id = 0; id < ctl->nd; id++)
-	beta[id] += ctmh2o(ctl->nu[id], los->p[ip], los->t[ip],
-			   los->q[ip][ig_h2o], los->u[ip][ig_h2o])
-	  / los->ds[ip];
-  }
-
-  /* N2 continuum... */
-  if (ctl->ctm_n2)
-    for (int id = 0; id < ctl->nd; id++)
-      beta[id] += ctmn2(ctl->nu[id], los->p[ip], los->t[ip]);
+	beta[id] = los->k[ip][id];
+      if (ctl->ctm_co2 && ctl->ig_co2 >= 0)
+	for (int id = 0; id < ctl->nd; id++)
+	  beta[id] += ctmco2(ctl->nu[id], los->p[ip], los->t[ip],
+			     los->u[ip][ctl->ig_co2]) / los->ds[ip];
+      if (ctl->ctm_h2o && ctl->ig_h2o >= 0)
+	for (int id = 0; id < ctl->nd; id++)
+	  beta[id] += ctmh2o(ctl->nu[id], los->p[ip], los->t[ip],
+			     los->q[ip][ctl->ig_h2o], los->u[ip][ctl->ig_h2o])
+	    / los->ds[ip];
+      if (ctl->ctm_n2)
+	for (int id = 0; id < ctl->nd; id++)
+	  beta[id] += ctmn2(ctl->nu[id], los->p[ip], los->t[ip]);
+      if (ctl->ctm_o2)
+	for (int id = 0; id < ctl->nd; id++)
+	  beta[id] += ctmo2(ctl->nu[id], los->p[ip], los->t[ip]);
+      continue;
+    }
 
-  /* O2 continuum... */
-  if (ctl->ctm_o2)
+    /* Determine index in temperature array... */
+    const double t = los->t[ip];
+    const int it = locate_reg(tbl->st, TBLNS, t);
+    const double w = (t - tbl->st[it]) / (tbl->st[it + 1] - tbl->st[it]);
+
+    /* Get scaling factors (zero for disabled continua)... */
+    double aco2 = 0, ah2os = 0, ah2of = 0, an2 = 0, ao2 = 0;
+    if (ctl->ctm_co2 && ctl->ig_co2 >= 0)
+      aco2 = los->u[ip][ctl->ig_co2] * los->p[ip] / P0 / los->ds[ip];
+    if (ctl->ctm_h2o && ctl->ig_h2o >= 0) {
+      const double q = los->q[ip][ctl->ig_h2o];
+      const double a =
+	los->u[ip][ctl->ig_h2o] * los->p[ip] / P0 / los->ds[ip];
+      ah2os = a * q;
+      ah2of = a * (1 - q);
+    }
+    if (ctl->ctm_n2)
+      an2 = POW2(los->p[ip] / P0);
+    if (ctl->ctm_o2)
+      ao2 = POW2(los->p[ip] / P0);
+
+    /* Add extinction and all continua... */
+    const double *co2_0 = tbl->ctmco2[it], *co2_1 = tbl->ctmco2[it + 1],
+      *h2os_0 = tbl->ctmh2os[it], *h2os_1 = tbl->ctmh2os[it + 1],
+      *h2of_0 = tbl->ctmh2of[it], *h2of_1 = tbl->ctmh2of[it + 1],
+      *n2_0 = tbl->ctmn2[it], *n2_1 = tbl->ctmn2[it + 1],
+      *o2_0 = tbl->ctmo2[it], *o2_1 = tbl->ctmo2[it + 1];
+#pragma omp simd
     for (int id = 0; id < ctl->nd; id++)
-      beta[id] += ctmo2(ctl->nu[id], los->p[ip], los->t[ip]);
+      los->beta[ip][id] = los->k[ip][id]
+	+ aco2 * (co2_0[id] + w * (co2_1[id] - co2_0[id]))
+	+ ah2os * (h2os_0[id] + w * (h2os_1[id] - h2os_0[id]))
+	+ ah2of * (h2of_0[id] + w * (h2of_1[id] - h2of_0[id]))
+	+ an2 * (n2_0[id] + w * (n2_1[id] - n2_0[id]))
+	+ ao2 * (o2_0[id] + w * (o2_1[id] - o2_0[id]));
+  }
 }
 
 /*****************************************************************************/
@@ -3135,9 +3189,10 @@ void formod_fov(
     return;
 
   /* Initialize FOV data... */
+#pragma omp critical (formod_fov_init)
   if (!init) {
-    init = 1;
     read_shape(ctl->fov, dz, w, &n);
+    init = 1;
   }
 
   /* Allocate... */
@@ -3193,31 +3248,15 @@ void formod_fov(
 
 /*****************************************************************************/
 
-void formod_pencil(
+void formod_los(
   const ctl_t *ctl,
-  const atm_t *atm,
+  const tbl_t *tbl,
+  los_t *los,
   obs_t *obs,
   const int ir) {
 
-  static tbl_t *tbl;
-
-  static int init = 0;
-
-  los_t *los;
-
-  double beta_ctm[ND], rad[ND], tau[ND], tau_refl[ND],
-    tau_path[ND][NG], tau_gas[ND], x0[3], x1[3];
-
-  /* Initialize look-up tables... */
-  if (!init) {
-    init = 1;
-    ALLOC(tbl, tbl_t, 1);
-    read_tbl(ctl, tbl);
-    init_srcfunc(ctl, tbl);
-  }
-
-  /* Allocate... */
-  ALLOC(los, los_t, 1);
+  double rad[ND], tau[ND], tau_refl[ND], tau_path[ND][NG], tau_gas[ND],
+    x0[3], x1[3];
 
   /* Initialize... */
   for (int id = 0; id < ctl->nd; id++) {
@@ -3227,37 +3266,35 @@ void formod_pencil(
       tau_path[id][ig] = 1;
   }
 
-  /* Raytracing... */
-  raytrace(ctl, atm, obs, los, ir);
+  /* Get continuum transmittance of all segments (kept in eps)... */
+  for (int ip = 0; ip < los->np; ip++)
+    vec_tau(ctl->nd, los->beta[ip], los->ds[ip], los->eps[ip]);
+
+  /* Get look-up table copy... */
+  const int ic = TBLCOPY(tbl);
 
   /* Loop over LOS points... */
   for (int ip = 0; ip < los->np; ip++) {
 
     /* Get trace gas transmittance... */
     if (ctl->formod == 0)
-      intpol_tbl_cga(ctl, tbl, los, ip, tau_path, tau_gas);
+      intpol_tbl_cga(ctl, tbl, ic, los, ip, tau_path, tau_gas);
     else
-      intpol_tbl_ega(ctl, tbl, los, ip, tau_path, tau_gas);
-
-    /* Get continuum absorption... */
-    formod_continua(ctl, los, ip, beta_ctm);
-
-    /* Compute Planck function... */
-    formod_srcfunc(ctl, tbl, los->t[ip], los->src[ip]);
+      intpol_tbl_ega(ctl, tbl, ic, los, ip, tau_path, tau_gas);
 
-    /* Loop over channels... */
-    for (int id = 0; id < ctl->nd; id++)
-      if (tau_gas[id] > 0) {
+    /* Loop over channels (opaque gas segments are skipped)... */
+    for (int id = 0; id < ctl->nd; id++) {
 
-	/* Get segment emissivity... */
-	los->eps[ip][id] = 1 - tau_gas[id] * exp(-beta_ctm[id] * los->ds[ip]);
+      /* Get segment emissivity... */
+      los->eps[ip][id] =
+	(tau_gas[id] > 0 ? 1 - tau_gas[id] * los->eps[ip][id] : 0);
 
-	/* Compute radiance... */
-	rad[id] += los->src[ip][id] * los->eps[ip][id] * tau[id];
+      /* Compute radiance... */
+      rad[id] += los->src[ip][id] * los->eps[ip][id] * tau[id];
 
-	/* Compute path transmittance... */
-	tau[id] *= (1 - los->eps[ip][id]);
-      }
+      /* Compute path transmittance... */
+      tau[id] *= (1 - los->eps[ip][id]);
+    }
   }
 
   /* Check whether LOS hit the ground... */
@@ -3332,6 +3369,240 @@ void formod_pencil(
     obs->rad[id][ir] = rad[id];
     obs->tau[id][ir] = tau[id];
   }
+}
+
+/*****************************************************************************/
+
+void formod_nadir(
+  const ctl_t *ctl,
+  const tbl_t *tbl,
+  const atm_t *atm,
+  obs_t *obs) {
+
+  los_t *col, *shl;
+
+  double (*cgu)[NG], (*rad)[ND], (*rdw)[ND], (*tau)[ND], (*tau_gas)[ND],
+    (*tau_path)[ND][NG], (*u)[NG], b[NR], cosa[NR], ds[NR], dz, src_sf[ND],
+    zmin;
+
+  int nr = 0, ray[NR];
+
+  /* Allocate... */
+  ALLOC(col, los_t, 1);
+  ALLOC(shl, los_t, 1);
+  ALLOC(cgu, double,
+	NR * NG);
+  ALLOC(rad, double,
+	NR * ND);
+  ALLOC(rdw, double,
+	NR * ND);
+  ALLOC(tau, double,
+	NR * ND);
+  ALLOC(tau_gas, double,
+	NR * ND);
+  ALLOC(tau_path, double,
+	NR * ND * NG);
+  ALLOC(u, double,
+	NR * NG);
+
+  /* Get atmospheric data of the layers... */
+  init_shells(ctl, tbl, atm, shl, &zmin, &dz);
+  const double rmin = RE + zmin, rmax = RE + zmin + shl->np * dz;
+
+  /* Get ray geometry... */
+  for (int ir = 0; ir < obs->nr; ir++) {
+
+    /* Initialize... */
+    for (int id = 0; id < ctl->nd; id++) {
+      obs->rad[id][ir] = 0;
+      obs->tau[id][ir] = 1;
+    }
+    obs->tpz[ir] = obs->vpz[ir];
+    obs->tplon[ir] = obs->vplon[ir];
+    obs->tplat[ir] = obs->vplat[ir];
+
+    /* Check view point altitude... */
+    if (obs->vpz[ir] > rmax - RE)
+      continue;
+
+    /* Get viewing direction in the plane of observer and view point... */
+    double eu[3], ew[3], ex[3], xo[3], xv[3];
+    geo2cart(obs->obsz[ir], obs->obslon[ir], obs->obslat[ir], xo);
+    geo2cart(obs->vpz[ir], obs->vplon[ir], obs->vplat[ir], xv);
+    for (int i = 0; i < 3; i++)
+      ex[i] = xv[i] - xo[i];
+    const double norm = NORM(ex);
+    const double ro = NORM(xo);
+    for (int i = 0; i < 3; i++) {
+      ex[i] /= norm;
+      eu[i] = xo[i] / ro;
+    }
+    const double cosz = DOTP(ex, eu);
+    for (int i = 0; i < 3; i++)
+      ew[i] = ex[i] - cosz * eu[i];
+    const double sinz = NORM(ew);
+
+    /* Check geometry... */
+    if (ro < rmax)
+      ERRMSG("Nadir geometry requires observer above atmosphere!");
+    if (cosz >= 0 || ro * sinz >= rmin)
+      ERRMSG("Nadir geometry requires rays hitting the ground!");
+
+    /* Get ground point... */
+    b[nr] = ro * sinz;
+    cosa[nr] = sqrt(1 - POW2(b[nr] / rmin));
+    const double phi = acos(b[nr] / ro) - acos(b[nr] / rmin);
+    for (int i = 0; i < 3; i++)
+      xv[i] = rmin * (cos(phi) * eu[i]
+		      + (sinz > 0 ? sin(phi) * ew[i] / sinz : 0));
+    cart2geo(xv, &obs->tpz[ir], &obs->tplon[ir], &obs->tplat[ir]);
+
+    /* Initialize... */
+    for (int id = 0; id < ctl->nd; id++) {
+      rad[nr][id] = 0;
+      rdw[nr][id] = 0;
+      tau[nr][id] = 1;
+      for (int ig = 0; ig < ctl->ng; ig++)
+	tau_path[nr][id][ig] = 1;
+    }
+    for (int ig = 0; ig < ctl->ng; ig++)
+      cgu[nr][ig] = 0;
+    ray[nr++] = ir;
+  }
+
+  /* Get vertical column from top to bottom... */
+  col->np = shl->np;
+  for (int ip = 0; ip < col->np; ip++) {
+    const int is = shl->np - 1 - ip;
+    col->z[ip] = shl->z[is];
+    col->p[ip] = shl->p[is];
+    col->t[ip] = shl->t[is];
+    for (int ig = 0; ig < ctl->ng; ig++) {
+      col->u[ip][ig] = shl->u[is][ig] * dz;
+      col->cgu[ip][ig] = (ip > 0 ? col->cgu[ip - 1][ig] : 0) + col->u[ip][ig];
+      col->cgp[ip][ig] = (ip > 0 ? col->cgp[ip - 1][ig] : 0)
+	+ col->u[ip][ig] * col->p[ip];
+      col->cgt[ip][ig] = (ip > 0 ? col->cgt[ip - 1][ig] : 0)
+	+ col->u[ip][ig] * col->t[ip];
+    }
+  }
+  for (int ip = 0; ip < col->np; ip++)
+    for (int ig = 0; ig < ctl->ng; ig++) {
+      col->cgp[ip][ig] /= col->cgu[ip][ig];
+      col->cgt[ip][ig] /= col->cgu[ip][ig];
+    }
+
+  /* Get look-up table copy... */
+  const int ic = TBLCOPY(tbl);
+
+  /* Loop over layers... */
+  for (int ip = 0; ip < col->np; ip++) {
+    const int is = shl->np - 1 - ip;
+
+    /* Scale column densities by air mass factors... */
+    for (int i = 0; i < nr; i++) {
+      const double r = (ctl->raygeom == 3 ? RE + col->z[ip] : rmin);
+      ds[i] = dz / sqrt(1 - POW2(b[i] / r));
+      for (int ig = 0; ig < ctl->ng; ig++) {
+	u[i][ig] = col->u[ip][ig] * ds[i] / dz;
+	cgu[i][ig] += u[i][ig];
+      }
+    }
+
+    /* Get trace gas transmittance for all rays... */
+    intpol_tbl_nadir(ctl, tbl, ic, col, ip, nr, u, cgu, tau_path, tau_gas);
+
+    /* Compute radiance, transmittance, and down-welling radiance... */
+    for (int i = 0; i < nr; i++)
+      for (int id = 0; id < ctl->nd; id++)
+	if (tau_gas[i][id] > 0) {
+	  const double eps =
+	    1 - tau_gas[i][id] * exp(-shl->beta[is][id] * ds[i]);
+	  rad[i][id] += shl->src[is][id] * eps * tau[i][id];
+	  rdw[i][id] = rdw[i][id] * (1 - eps) + shl->src[is][id] * eps;
+	  tau[i][id] *= (1 - eps);
+	}
+  }
+
+  /* Add surface emissions... */
+  if (ctl->sftype >= 1) {
+    formod_srcfunc(ctl, tbl, shl->sft, src_sf);
+    for (int i = 0; i < nr; i++)
+      for (int id = 0; id < ctl->nd; id++)
+	rad[i][id] += shl->sfeps[id] * src_sf[id] * tau[i][id];
+  }
+
+  /* Add reflected down-welling and solar radiation... */
+  if (ctl->sftype >= 2)
+    for (int i = 0; i < nr; i++) {
+      const int ir = ray[i];
+      double rsun = 0;
+      if (ctl->sftype >= 3) {
+	const double sza2 = (ctl->sfsza < 0 ?
+			     sza(obs->time[ir], obs->tplon[ir],
+				 obs->tplat[ir]) : ctl->sfsza);
+	if (sza2 < 89.999)
+	  rsun = cosa[i] / cos(DEG2RAD(sza2));
+      }
+      for (int id = 0; id < ctl->nd; id++)
+	rad[i][id] += (1 - shl->sfeps[id]) * tau[i][id]
+	  * (rdw[i][id] + 6.764e-5 / (2. * M_PI) * PLANCK(TSUN, ctl->nu[id])
+	     * tau[i][id] * rsun);
+    }
+
+  /* Copy results... */
+  for (int i = 0; i < nr; i++)
+    for (int id = 0; id < ctl->nd; id++) {
+      obs->rad[id][ray[i]] = rad[i][id];
+      obs->tau[id][ray[i]] = tau[i][id];
+    }
+
+  /* Free... */
+  free(col);
+  free(shl);
+  free(cgu);
+  free(rad);
+  free(rdw);
+  free(tau);
+  free(tau_gas);
+  free(tau_path);
+  free(u);
+}
+
+/*****************************************************************************/
+
+void formod_pencil(
+  const ctl_t *ctl,
+  const tbl_t *tbl,
+  const atm_t *atm,
+  obs_t *obs,
+  const int ir0,
+  const int nb) {
+
+  los_t *los;
+
+  /* Allocate... */
+  ALLOC(los, los_t, nb);
+
+  /* Raytracing... */
+  if (nb == 1)
+    raytrace(ctl, atm, obs, los, ir0);
+  else
+    raytrace_batch(ctl, atm, obs, los, ir0, nb);
+
+  /* Loop over rays... */
+  for (int b = 0; b < nb; b++) {
+
+    /* Get continuum absorption... */
+    formod_continua(ctl, tbl, &los[b]);
+
+    /* Compute Planck function... */
+    for (int ip = 0; ip < los[b].np; ip++)
+      formod_srcfunc(ctl, tbl, los[b].t[ip], los[b].src[ip]);
+
+    /* Compute radiative transfer... */
+    formod_los(ctl, tbl, &los[b], obs, ir0 + b);
+  }
 
   /* Free... */
   free(los);
@@ -3372,6 +3643,10 @@ void formod_rfm(
       if (atm->k[iw][ip] != 0)
 	ERRMSG("RFM interface cannot handle extinction data!");
 
+  /* Check atmospheric data... */
+  if (atm->nlon > 1 || atm->nlat > 1)
+    ERRMSG("RFM interface cannot handle 3D atmospheric data!");
+
   /* Get altitude range of atmospheric data... */
   gsl_stats_minmax(&zmin, &zmax, atm->z, 1, (size_t) atm->np);
 
@@ -3480,6 +3755,213 @@ void formod_rfm(
 
 /*****************************************************************************/
 
+void formod_shells(
+  const ctl_t *ctl,
+  const tbl_t *tbl,
+  const atm_t *atm,
+  obs_t *obs) {
+
+  los_t *los, *shl;
+
+  double dz, ew[3], ex[3], eu[3], n[NLOS], g[NLOS], rl[NLOS + 1],
+    rho[NLOS + 1], xo[3], xv[3], zmin;
+
+  /* Allocate... */
+  ALLOC(los, los_t, 1);
+  ALLOC(shl, los_t, 1);
+
+  /* Get atmospheric data of the shells... */
+  init_shells(ctl, tbl, atm, shl, &zmin, &dz);
+  const int nshl = shl->np;
+  const double zmax = zmin + nshl * dz;
+
+  /* Get refractive indices of the shells (no cut-off altitude here,
+     to keep the refractive index continuous)... */
+  for (int is = 0; is < nshl; is++)
+    n[is] = (ctl->refrac ? 1 + REFRAC(shl->p[is], shl->t[is]) : 1);
+
+  /* Get radii and reduced radii rho = n * r of the shell boundaries
+     (rays are straight lines in rho, see Bouguer's formula)... */
+  for (int is = 0; is <= nshl; is++) {
+    rl[is] = RE + zmin + is * dz;
+    rho[is] = rl[is] * (is == 0 ? n[0] : is == nshl ? n[nshl - 1]
+			: 0.5 * (n[is - 1] + n[is]));
+  }
+
+  /* Get scaling factors dr/drho of the shells... */
+  for (int is = 0; is < nshl; is++)
+    g[is] = dz / (rho[is + 1] - rho[is]);
+
+  /* Loop over rays... */
+  for (int ir = 0; ir < obs->nr; ir++) {
+
+    /* Initialize... */
+    los->np = 0;
+    los->sft = -999;
+    obs->tpz[ir] = obs->vpz[ir];
+    obs->tplon[ir] = obs->vplon[ir];
+    obs->tplat[ir] = obs->vplat[ir];
+
+    /* Check observer altitude... */
+    if (obs->obsz[ir] < zmin)
+      ERRMSG("Observer below surface!");
+
+    /* Get viewing direction in the plane of observer and view point... */
+    geo2cart(obs->obsz[ir], obs->obslon[ir], obs->obslat[ir], xo);
+    geo2cart(obs->vpz[ir], obs->vplon[ir], obs->vplat[ir], xv);
+    for (int i = 0; i < 3; i++)
+      ex[i] = xv[i] - xo[i];
+    const double norm = NORM(ex);
+    const double ro = NORM(xo);
+    for (int i = 0; i < 3; i++) {
+      ex[i] /= norm;
+      eu[i] = xo[i] / ro;
+    }
+    const double cosz = DOTP(ex, eu);
+    for (int i = 0; i < 3; i++)
+      ew[i] = ex[i] - cosz * eu[i];
+    const double sinz = NORM(ew);
+    for (int i = 0; i < 3; i++)
+      ew[i] = (sinz > 0 ? ew[i] / sinz : 0);
+
+    /* Get start shell and ray constant (Bouguer's formula)... */
+    const int is0 = (ro < rl[nshl]
+		     ? MIN((int) ((ro - rl[0]) / dz), nshl - 1) : nshl - 1);
+    const double rho0 = (ro < rl[nshl]
+			 ? rho[is0] + (ro - rl[is0]) / g[is0] : rho[nshl]);
+    const double c = (ro < rl[nshl] ? rho0 : ro) * sinz;
+
+    /* Check whether ray passes the atmosphere... */
+    if (obs->vpz[ir] > zmax
+	|| (ro >= rl[nshl] && (cosz >= 0 || c >= rho[nshl]))) {
+      formod_los(ctl, tbl, los, obs, ir);
+      continue;
+    }
+
+    /* Follow downward leg of the ray (chords s = sqrt(rho^2 - c^2) are
+       scaled by dr/drho, central angles by n * dr/drho)... */
+    double dphi[NLOS], ds[NLOS], zs[NLOS], phi = 0, phit = -1, rt = 0;
+    int is = is0, iss[NLOS], nseg = 0, stop = 0;
+    if (cosz < 0 || ro >= rl[nshl])
+      for (; is >= 0; is--) {
+	const double ra = (nseg == 0 ? rho0 : rho[is + 1]);
+	const double sa = sqrt(MAX(POW2(ra) - POW2(c), 0));
+	const double s1 = sqrt(MAX(POW2(rho[is + 1]) - POW2(c), 0));
+	iss[nseg] = is;
+	if (c >= rho[is]) {
+	  rt = rl[is] + (c - rho[is]) * g[is];
+	  phit = phi + acos(MIN(c / ra, 1)) * n[is] * g[is];
+	  ds[nseg] = (sa + s1) * g[is];
+	  zs[nseg] = (sa + s1 > 0 ? (RAYINT(sa, c) + RAYINT(s1, c))
+		      / (sa + s1) : c);
+	  dphi[nseg] = (acos(MIN(c / ra, 1)) + acos(MIN(c / rho[is + 1], 1)))
+	    * n[is] * g[is];
+	  phi += dphi[nseg++];
+	  break;
+	}
+	const double s0 = sqrt(MAX(POW2(rho[is]) - POW2(c), 0));
+	ds[nseg] = (sa - s0) * g[is];
+	zs[nseg] = (sa > s0 ? (RAYINT(sa, c) - RAYINT(s0, c)) / (sa - s0)
+		    : 0.5 * (ra + rho[is]));
+	dphi[nseg] = (acos(MIN(c / ra, 1)) - acos(MIN(c / rho[is], 1)))
+	  * n[is] * g[is];
+	phi += dphi[nseg++];
+	if (is == 0)
+	  stop = 2;
+      }
+
+    /* Follow upward leg of the ray... */
+    if (!stop)
+      for (is = (nseg > 0 ? is + 1 : is0); is < nshl; is++) {
+	const double ra = (nseg == 0 ? rho0 : rho[is]);
+	const double sa = sqrt(MAX(POW2(ra) - POW2(c), 0));
+	const double s1 = sqrt(MAX(POW2(rho[is + 1]) - POW2(c), 0));
+	iss[nseg] = is;
+	ds[nseg] = (s1 - sa) * g[is];
+	zs[nseg] = (s1 > sa ? (RAYINT(s1, c) - RAYINT(sa, c)) / (s1 - sa)
+		    : 0.5 * (ra + rho[is + 1]));
+	dphi[nseg] = (acos(MIN(c / rho[is + 1], 1)) - acos(MIN(c / ra, 1)))
+	  * n[is] * g[is];
+	phi += dphi[nseg++];
+      }
+
+    /* Copy shell data to LOS (interpolated to the path-weighted mean
+       altitude of each segment)... */
+    phi = 0;
+    for (int ip = 0; ip < nseg; ip++) {
+      double x[3], z;
+      const int iz = iss[ip];
+      const double zm = rl[iz] + (zs[ip] - rho[iz]) * g[iz] - RE;
+      const int i0 = MAX(MIN((int) floor((zm - shl->z[0]) / dz), nshl - 2), 0);
+      const int i1 = MIN(i0 + 1, nshl - 1);
+      const double w = MIN(MAX((zm - shl->z[i0]) / dz, 0), 1);
+      for (int i = 0; i < 3; i++)
+	x[i] = (RE + zm) * (cos(phi + 0.5 * dphi[ip]) * eu[i]
+			    + sin(phi + 0.5 * dphi[ip]) * ew[i]);
+      cart2geo(x, &z, &los->lon[ip], &los->lat[ip]);
+      los->z[ip] = zm;
+      los->p[ip] = LIN(0, shl->p[i0], 1, shl->p[i1], w);
+      los->t[ip] = LIN(0, shl->t[i0], 1, shl->t[i1], w);
+      los->ds[ip] = ds[ip];
+      for (int ig = 0; ig < ctl->ng; ig++) {
+	los->q[ip][ig] = LIN(0, shl->q[i0][ig], 1, shl->q[i1][ig], w);
+	los->u[ip][ig] = LIN(0, shl->u[i0][ig], 1, shl->u[i1][ig], w) * ds[ip];
+      }
+      for (int id = 0; id < ctl->nd; id++) {
+	los->k[ip][id] = LIN(0, shl->k[i0][id], 1, shl->k[i1][id], w);
+	los->beta[ip][id] = LIN(0, shl->beta[i0][id], 1, shl->beta[i1][id], w);
+	los->src[ip][id] = LIN(0, shl->src[i0][id], 1, shl->src[i1][id], w);
+      }
+      phi += dphi[ip];
+    }
+    los->np = nseg;
+
+    /* Set surface data... */
+    if (stop == 2) {
+      los->sft = shl->sft;
+      for (int id = 0; id < ctl->nd; id++)
+	los->sfeps[id] = shl->sfeps[id];
+    }
+
+    /* Get tangent point (or end point for nadir and zenith)... */
+    double x[3];
+    if (phit < 0) {
+      phit = phi;
+      rt = (stop == 2 ? rl[0] : rl[nshl]);
+    }
+    for (int i = 0; i < 3; i++)
+      x[i] = rt * (cos(phit) * eu[i] + sin(phit) * ew[i]);
+    cart2geo(x, &obs->tpz[ir], &obs->tplon[ir], &obs->tplat[ir]);
+
+    /* Compute Curtis-Godson means... */
+    for (int ig = 0; ig < ctl->ng; ig++) {
+      los->cgu[0][ig] = los->u[0][ig];
+      los->cgp[0][ig] = los->u[0][ig] * los->p[0];
+      los->cgt[0][ig] = los->u[0][ig] * los->t[0];
+    }
+    for (int ip = 1; ip < los->np; ip++)
+      for (int ig = 0; ig < ctl->ng; ig++) {
+	los->cgu[ip][ig] = los->cgu[ip - 1][ig] + los->u[ip][ig];
+	los->cgp[ip][ig] = los->cgp[ip - 1][ig] + los->u[ip][ig] * los->p[ip];
+	los->cgt[ip][ig] = los->cgt[ip - 1][ig] + los->u[ip][ig] * los->t[ip];
+      }
+    for (int ip = 0; ip < los->np; ip++)
+      for (int ig = 0; ig < ctl->ng; ig++) {
+	los->cgp[ip][ig] /= los->cgu[ip][ig];
+	los->cgt[ip][ig] /= los->cgu[ip][ig];
+      }
+
+    /* Compute radiative transfer... */
+    formod_los(ctl, tbl, los, obs, ir);
+  }
+
+  /* Free... */
+  free(los);
+  free(shl);
+}
+
+/*****************************************************************************/
+
 void formod_srcfunc(
   const ctl_t *ctl,
   const tbl_t *tbl,
@@ -3517,6 +3999,50 @@ void geo2cart(
 
 /*****************************************************************************/
 
+unsigned long long hash_data(
+  const void *data,
+  const size_t n,
+  unsigned long long hash) {
+
+  const unsigned char *c = data;
+
+  /* Update FNV-1a hash... */
+  for (size_t i = 0; i < n; i++) {
+    hash ^= c[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+/*****************************************************************************/
+
+unsigned long long hash_file(
+  const char *filename) {
+
+  FILE *in;
+
+  unsigned char buf[65536];
+
+  size_t n;
+
+  /* Open file... */
+  if (!(in = fopen(filename, "r")))
+    ERRMSG("Cannot open file!");
+
+  /* Compute FNV-1a hash... */
+  unsigned long long hash = 14695981039346656037ULL;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+    hash = hash_data(buf, n, hash);
+
+  /* Close file... */
+  fclose(in);
+
+  return hash;
+}
+
+/*****************************************************************************/
+
 void hydrostatic(
   const ctl_t *ctl,
   atm_t *atm) {
@@ -3525,59 +4051,65 @@ void hydrostatic(
 
   const int ipts = 20;
 
-  static int ig_h2o = -999;
-
-  double dzmin = 1e99, e = 0;
-
-  int ipref = 0;
-
   /* Check reference height... */
   if (ctl->hydz < 0)
     return;
 
-  /* Determine emitter index of H2O... */
-  if (ig_h2o == -999)
-    ig_h2o = find_emitter(ctl, "H2O");
+  /* Get number of altitude levels and profiles... */
+  const int nz = (atm->nlon > 1 || atm->nlat > 1 ? atm->nz : atm->np);
+  const int ncol = atm->np / nz;
 
-  /* Find air parcel next to reference height... */
-  for (int ip = 0; ip < atm->np; ip++)
-    if (fabs(atm->z[ip] - ctl->hydz) < dzmin) {
-      dzmin = fabs(atm->z[ip] - ctl->hydz);
-      ipref = ip;
-    }
+  /* Loop over profiles... */
+  for (int ic = 0; ic < ncol; ic++) {
 
-  /* Upper part of profile... */
-  for (int ip = ipref + 1; ip < atm->np; ip++) {
-    double mean = 0;
-    for (int i = 0; i < ipts; i++) {
-      if (ig_h2o >= 0)
-	e = LIN(0.0, atm->q[ig_h2o][ip - 1],
-		ipts - 1.0, atm->q[ig_h2o][ip], (double) i);
-      mean += (e * mmh2o + (1 - e) * mmair)
-	* G0 / RI
-	/ LIN(0.0, atm->t[ip - 1], ipts - 1.0, atm->t[ip], (double) i) / ipts;
-    }
+    const int i0 = ic * nz, i1 = i0 + nz;
 
-    /* Compute p(z,T)... */
-    atm->p[ip] =
-      exp(log(atm->p[ip - 1]) - mean * 1000 * (atm->z[ip] - atm->z[ip - 1]));
-  }
+    double dzmin = 1e99, e = 0;
+
+    int ipref = i0;
 
-  /* Lower part of profile... */
-  for (int ip = ipref - 1; ip >= 0; ip--) {
-    double mean = 0;
-    for (int i = 0; i < ipts; i++) {
-      if (ig_h2o >= 0)
-	e = LIN(0.0, atm->q[ig_h2o][ip + 1],
-		ipts - 1.0, atm->q[ig_h2o][ip], (double) i);
-      mean += (e * mmh2o + (1 - e) * mmair)
-	* G0 / RI
-	/ LIN(0.0, atm->t[ip + 1], ipts - 1.0, atm->t[ip], (double) i) / ipts;
+    /* Find air parcel next to reference height... */
+    for (int ip = i0; ip < i1; ip++)
+      if (fabs(atm->z[ip] - ctl->hydz) < dzmin) {
+	dzmin = fabs(atm->z[ip] - ctl->hydz);
+	ipref = ip;
+      }
+
+    /* Upper part of profile... */
+    for (int ip = ipref + 1; ip < i1; ip++) {
+      double mean = 0;
+      for (int i = 0; i < ipts; i++) {
+	if (ctl->ig_h2o >= 0)
+	  e = LIN(0.0, atm->q[ctl->ig_h2o][ip - 1],
+		  ipts - 1.0, atm->q[ctl->ig_h2o][ip], (double) i);
+	mean += (e * mmh2o + (1 - e) * mmair)
+	  * G0 / RI
+	  / LIN(0.0, atm->t[ip - 1], ipts - 1.0, atm->t[ip],
+		(double) i) / ipts;
+      }
+
+      /* Compute p(z,T)... */
+      atm->p[ip] =
+	exp(log(atm->p[ip - 1]) - mean * 1000 * (atm->z[ip] - atm->z[ip - 1]));
     }
 
-    /* Compute p(z,T)... */
-    atm->p[ip] =
-      exp(log(atm->p[ip + 1]) - mean * 1000 * (atm->z[ip] - atm->z[ip + 1]));
+    /* Lower part of profile... */
+    for (int ip = ipref - 1; ip >= i0; ip--) {
+      double mean = 0;
+      for (int i = 0; i < ipts; i++) {
+	if (ctl->ig_h2o >= 0)
+	  e = LIN(0.0, atm->q[ctl->ig_h2o][ip + 1],
+		  ipts - 1.0, atm->q[ctl->ig_h2o][ip], (double) i);
+	mean += (e * mmh2o + (1 - e) * mmair)
+	  * G0 / RI
+	  / LIN(0.0, atm->t[ip + 1], ipts - 1.0, atm->t[ip],
+		(double) i) / ipts;
+      }
+
+      /* Compute p(z,T)... */
+      atm->p[ip] =
+	exp(log(atm->p[ip + 1]) - mean * 1000 * (atm->z[ip] - atm->z[ip + 1]));
+    }
   }
 }
 
@@ -3628,56 +4160,467 @@ void idx2name(
 
 /*****************************************************************************/
 
-void init_srcfunc(
+void init_continua(
   const ctl_t *ctl,
   tbl_t *tbl) {
 
-  char filename[2 * LEN];
-
-  double f[NSHAPE], nu[NSHAPE];
-
-  int n;
-
   /* Write info... */
-  LOG(1, "Initialize source function table...");
+  LOG(1, "Initialize continuum table...");
   LOG(2, "Number of data points: %d", TBLNS);
 
-  /* Loop over channels... */
-  for (int id = 0; id < ctl->nd; id++) {
+  /* Tabulate temperature dependence for unit pressure, column density,
+     and mixing ratio... */
+#pragma omp parallel for default(shared)
+  for (int it = 0; it < TBLNS; it++) {
+    tbl->st[it] = LIN(0.0, TMIN, TBLNS - 1.0, TMAX, (double) it);
+    for (int id = 0; id < ctl->nd; id++) {
+      tbl->ctmco2[it][id] = ctmco2(ctl->nu[id], P0, tbl->st[it], 1);
+      tbl->ctmh2os[it][id] = ctmh2o(ctl->nu[id], P0, tbl->st[it], 1, 1);
+      tbl->ctmh2of[it][id] = ctmh2o(ctl->nu[id], P0, tbl->st[it], 0, 1);
+      tbl->ctmn2[it][id] = ctmn2(ctl->nu[id], P0, tbl->st[it]);
+      tbl->ctmo2[it][id] = ctmo2(ctl->nu[id], P0, tbl->st[it]);
+    }
+  }
+}
 
-    /* Read filter function... */
-    sprintf(filename, "%s_%.4f.filt", ctl->tblbase, ctl->nu[id]);
-    read_shape(filename, nu, f, &n);
+/*****************************************************************************/
 
-    /* Get minimum grid spacing... */
+void init_ctl(
+  ctl_t *ctl) {
+
+  /* Get emitter indices... */
+  ctl->ig_co2 = find_emitter(ctl, "CO2");
+  ctl->ig_h2o = find_emitter(ctl, "H2O");
+
+  /* Get spectral interpolation indices and weights... */
+  for (int id = 0; id < ctl->nd; id++) {
+    ctl->clidx[id] = ctl->sfidx[id] = 0;
+    ctl->clw[id] = ctl->sfw[id] = 0;
+    if (ctl->ncl > 0) {
+      const int icl = locate_irr(ctl->clnu, ctl->ncl, ctl->nu[id]);
+      ctl->clidx[id] = icl;
+      ctl->clw[id] = (ctl->nu[id] - ctl->clnu[icl])
+	/ (ctl->clnu[icl + 1] - ctl->clnu[icl]);
+    }
+    if (ctl->nsf > 0) {
+      const int isf = locate_irr(ctl->sfnu, ctl->nsf, ctl->nu[id]);
+      ctl->sfidx[id] = isf;
+      ctl->sfw[id] = (ctl->nu[id] - ctl->sfnu[isf])
+	/ (ctl->sfnu[isf + 1] - ctl->sfnu[isf]);
+    }
+  }
+}
+
+/*****************************************************************************/
+
+void init_shells(
+  const ctl_t *ctl,
+  const tbl_t *tbl,
+  const atm_t *atm,
+  los_t *shl,
+  double *zmin,
+  double *dz) {
+
+  double k[NW], zmax;
+
+  /* Get altitude range of atmospheric data... */
+  gsl_stats_minmax(zmin, &zmax, atm->z, 1, (size_t) atm->np);
+  if (ctl->nsf > 0) {
+    *zmin = MAX(atm->sfz, *zmin);
+    if (atm->sfp > 0) {
+      const int ip = locate_irr(atm->p, atm->np, atm->sfp);
+      const double zip =
+	LIN(log(atm->p[ip]), atm->z[ip], log(atm->p[ip + 1]), atm->z[ip + 1],
+	    log(atm->sfp));
+      *zmin = MAX(zip, *zmin);
+    }
+  }
+
+  /* Set number and thickness of shells... */
+  const double dz0 = (ctl->raydz > 0 ? ctl->raydz : ctl->rayds);
+  shl->np = MAX(MIN((int) ceil((zmax - *zmin) / dz0), NLOS / 2), 1);
+  *dz = (zmax - *zmin) / shl->np;
+
+  /* Get atmospheric data, continua, and source function of the shells... */
+  for (int is = 0; is < shl->np; is++) {
+    shl->z[is] = *zmin + (is + 0.5) * *dz;
+    intpol_atm(ctl, atm, shl->z[is], atm->lon[0], atm->lat[0], &shl->p[is],
+	       &shl->t[is], shl->q[is], k);
+    for (int id = 0; id < ctl->nd; id++)
+      shl->k[is][id] = k[ctl->window[id]];
+    if (ctl->ncl > 0 && atm->cldz > 0) {
+      const double aux =
+	exp(-0.5 * POW2((shl->z[is] - atm->clz) / atm->cldz));
+      for (int id = 0; id < ctl->nd; id++) {
+	const int icl = ctl->clidx[id];
+	shl->k[is][id] += aux * (atm->clk[icl] + ctl->clw[id]
+				 * (atm->clk[icl + 1] - atm->clk[icl]));
+      }
+    }
+    shl->ds[is] = 1;
+    for (int ig = 0; ig < ctl->ng; ig++)
+      shl->u[is][ig] = 10 * shl->q[is][ig] * shl->p[is] / (KB * shl->t[is]);
+    formod_srcfunc(ctl, tbl, shl->t[is], shl->src[is]);
+  }
+  formod_continua(ctl, tbl, shl);
+
+  /* Get surface temperature and emissivity... */
+  if (ctl->nsf > 0 && atm->sft > 0)
+    shl->sft = atm->sft;
+  else {
+    double p0, q0[NG];
+    intpol_atm(ctl, atm, *zmin, atm->lon[0], atm->lat[0], &p0, &shl->sft,
+	       q0, k);
+  }
+  for (int id = 0; id < ctl->nd; id++) {
+    shl->sfeps[id] = 1.0;
+    if (ctl->nsf > 0) {
+      const int isf = ctl->sfidx[id];
+      shl->sfeps[id] = atm->sfeps[isf] + ctl->sfw[id]
+	* (atm->sfeps[isf + 1] - atm->sfeps[isf]);
+    }
+  }
+}
+
+/*****************************************************************************/
+
+void init_srcfunc(
+  const ctl_t *ctl,
+  tbl_t *tbl) {
+
+  char filename[2 * LEN];
+
+  double f[NSHAPE], nu[NSHAPE], *ff[ND], *c1[ND], *c2[ND], fsum[ND];
+
+  unsigned long long hash[ND];
+
+  int done[ND], n, nf[ND], ncache = 0;
+
+  /* Write info... */
+  LOG(1, "Initialize source function table...");
+  LOG(2, "Number of data points: %d", TBLNS);
+
+  /* Set temperatures... */
+  for (int it = 0; it < TBLNS; it++)
+    tbl->st[it] = LIN(0.0, TMIN, TBLNS - 1.0, TMAX, (double) it);
+
+  /* Read cached data... */
+  for (int id = 0; id < ctl->nd; id++)
+    done[id] = 0;
+  if (ctl->srccache[0] != '-') {
+    for (int id = 0; id < ctl->nd; id++) {
+      sprintf(filename, "%s_%.4f.filt", ctl->tblbase, ctl->nu[id]);
+      hash[id] = hash_file(filename);
+    }
+    ncache = read_srcfunc(ctl->srccache, ctl, tbl, hash, done);
+  }
+
+  /* Loop over channels... */
+  for (int id = 0; id < ctl->nd; id++) {
+
+    /* Check cache... */
+    nf[id] = 0;
+    if (done[id])
+      continue;
+
+    /* Read filter function... */
+    sprintf(filename, "%s_%.4f.filt", ctl->tblbase, ctl->nu[id]);
+    read_shape(filename, nu, f, &n);
+
+    /* Get minimum grid spacing... */
     double dnu = 1.0;
     for (int i = 1; i < n; i++)
       dnu = MIN(dnu, nu[i] - nu[i - 1]);
 
-    /* Compute source function table... */
-#pragma omp parallel for default(none) shared(ctl,tbl,id,nu,f,n,dnu)
-    for (int it = 0; it < TBLNS; it++) {
+    /* Get size of integration grid... */
+    for (double fnu = nu[0]; fnu <= nu[n - 1]; fnu += dnu)
+      nf[id]++;
+    ALLOC(ff[id], double, nf[id]);
+    ALLOC(c1[id], double, nf[id]);
+    ALLOC(c2[id], double, nf[id]);
+
+    /* Resample filter function onto integration grid... */
+    int i = 0, j = 0;
+    fsum[id] = 0;
+    for (double fnu = nu[0]; fnu <= nu[n - 1]; fnu += dnu, j++) {
+      while (i < n - 2 && nu[i + 1] <= fnu)
+	i++;
+      ff[id][j] = LIN(nu[i], f[i], nu[i + 1], f[i + 1], fnu);
+      c1[id][j] = C1 * POW3(fnu);
+      c2[id][j] = C2 * fnu;
+      fsum[id] += ff[id][j];
+    }
+  }
 
-      /* Set temperature... */
-      tbl->st[it] = LIN(0.0, TMIN, TBLNS - 1.0, TMAX, (double) it);
+  /* Integrate Planck function over channels and temperatures... */
+#pragma omp parallel for default(none) shared(ctl,tbl,done,nf,ff,c1,c2,fsum) collapse(2)
+  for (int id = 0; id < ctl->nd; id++)
+    for (int it = 0; it < TBLNS; it++) {
+      if (done[id])
+	continue;
+      const double t = tbl->st[it];
+      tbl->sr[it][id] =
+	vec_planck(nf[id], ff[id], c1[id], c2[id], t) / fsum[id];
+    }
 
-      /* Integrate Planck function... */
-      double fsum = tbl->sr[it][id] = 0;
-      for (double fnu = nu[0]; fnu <= nu[n - 1]; fnu += dnu) {
-	const int i = locate_irr(nu, n, fnu);
-	const double ff = LIN(nu[i], f[i], nu[i + 1], f[i + 1], fnu);
-	fsum += ff;
-	tbl->sr[it][id] += ff * PLANCK(tbl->st[it], fnu);
-      }
-      tbl->sr[it][id] /= fsum;
+  /* Free... */
+  for (int id = 0; id < ctl->nd; id++)
+    if (!done[id]) {
+      free(ff[id]);
+      free(c1[id]);
+      free(c2[id]);
     }
 
-    /* Write info... */
+  /* Write info... */
+  for (int id = 0; id < ctl->nd; id++)
     LOG(2,
 	"channel= %.4f cm^-1 | T= %g ... %g K | B= %g ... %g W/(m^2 sr cm^-1)",
 	ctl->nu[id], tbl->st[0], tbl->st[TBLNS - 1], tbl->sr[0][id],
 	tbl->sr[TBLNS - 1][id]);
+
+  /* Update cache... */
+  if (ctl->srccache[0] != '-' && ncache < ctl->nd)
+    write_srcfunc(ctl->srccache, ctl, tbl, hash);
+}
+
+/*****************************************************************************/
+
+void init_tbl(
+  const ctl_t *ctl,
+  tbl_t *tbl) {
+
+  FILE *in;
+
+  char filename[LEN], line[LEN], *tok;
+
+  float *buf;
+
+  int cpu0, cpu1, nnode = 0;
+
+  /* Check if tables were already converted... */
+  if (tbl->ui[0] != NULL)
+    ERRMSG("Look-up table layout has already been initialized!");
+
+  /* Get NUMA node of each CPU... */
+  for (int cpu = 0; cpu < NCPU; cpu++)
+    tbl->cpunode[cpu] = 0;
+  for (int node = 0; node < NNODE; node++) {
+    sprintf(filename, "/sys/devices/system/node/node%d/cpulist", node);
+    if (!(in = fopen(filename, "r")))
+      break;
+    if (fgets(line, LEN, in))
+      for (tok = strtok(line, ",\n"); tok != NULL; tok = strtok(NULL, ",\n"))
+	if (sscanf(tok, "%d-%d", &cpu0, &cpu1) >= 1) {
+	  if (!strchr(tok, '-'))
+	    cpu1 = cpu0;
+	  for (int cpu = MAX(cpu0, 0); cpu <= MIN(cpu1, NCPU - 1); cpu++)
+	    tbl->cpunode[cpu] = node;
+	}
+    fclose(in);
+    nnode++;
+  }
+  nnode = MAX(nnode, 1);
+
+  /* Write info... */
+  LOG(1, "Look-up table placement: %s pages | NUMA nodes= %d | %s",
+      ctl->tblhuge == 0 ? "normal" : ctl->tblhuge ==
+      1 ? "transparent huge" : "explicit huge", nnode,
+      ctl->tblnuma == 0 ? "first touch" : ctl->tblnuma ==
+      1 ? "interleaved" : "replicated per node");
+
+  /* Check layout... */
+  if (ctl->tbllayout != 1)
+    return;
+
+  /* Write info... */
+  LOG(1, "Initialize channel-inner look-up table layout...");
+
+  /* Set size of channel-inner layout... */
+  tbl->ndi = ctl->nd;
+  tbl->ncopy = (ctl->tblnuma == 2 ? nnode : 1);
+  const size_t n = (size_t) ctl->ng * TBLNP * TBLNT * (size_t) ctl->nd * TBLNU;
+  tbl->nbytes = n * sizeof(float);
+
+  /* Convert data in place (the first copy reuses the memory of the
+     channel-outer arrays, which are no longer valid afterwards)... */
+  ALLOC(buf, float, n);
+  for (int iv = 0; iv < 2; iv++) {
+    float *data = (iv == 0 ? &tbl->u[0][0][0][0][0]
+		   : &tbl->eps[0][0][0][0][0]);
+    for (int id = 0; id < ctl->nd; id++)
+      for (int ig = 0; ig < ctl->ng; ig++)
+	for (int ip = 0; ip < tbl->np[id][ig]; ip++)
+	  for (int it = 0; it < tbl->nt[id][ig][ip]; it++) {
+	    const float *src = (iv == 0 ? tbl->u[id][ig][ip][it]
+				: tbl->eps[id][ig][ip][it]);
+	    memcpy(buf + TBLIDX(tbl, id, ig, ip, it), src,
+		   (size_t) tbl->nu[id][ig][ip][it] * sizeof(float));
+	  }
+    memcpy(data, buf, tbl->nbytes);
+  }
+  free(buf);
+  tbl->ui[0] = &tbl->u[0][0][0][0][0];
+  tbl->epsi[0] = &tbl->eps[0][0][0][0][0];
+
+  /* Replicate tables on the other NUMA nodes... */
+  for (int ic = 1; ic < tbl->ncopy; ic++) {
+    tbl->ui[ic] = tbl_alloc(ctl, tbl->nbytes, ic);
+    tbl->epsi[ic] = tbl_alloc(ctl, tbl->nbytes, ic);
+    memcpy(tbl->ui[ic], tbl->ui[0], tbl->nbytes);
+    memcpy(tbl->epsi[ic], tbl->epsi[0], tbl->nbytes);
   }
+
+  /* Write info... */
+  LOG(2, "Memory usage of replicated tables: %g MByte",
+      2. * (double) (tbl->ncopy - 1) * (double) tbl->nbytes / 1e6);
+}
+
+/*****************************************************************************/
+
+void init_tbl_quant(
+  const ctl_t *ctl,
+  tbl_t *tbl) {
+
+  double errmax = 0;
+
+  size_t nq = 0, norg = 0;
+
+  unsigned short *qbuf;
+
+  int ncurve = 0, nquant = 0;
+
+  /* Free quantised tables... */
+  free(tbl->qn);
+  free(tbl->qoff);
+  free(tbl->qlu0);
+  free(tbl->qdlu);
+  free(tbl->qs0);
+  free(tbl->qa);
+  free(tbl->qeps);
+  tbl->qn = NULL;
+  tbl->qoff = NULL;
+  tbl->qlu0 = tbl->qdlu = NULL;
+  tbl->qs0 = tbl->qa = NULL;
+  tbl->qeps = NULL;
+
+  /* Check option... */
+  if (ctl->tblquant != 1)
+    return;
+
+  /* Write info... */
+  LOG(1, "Initialize quantised emissivity tables...");
+
+  /* Allocate... */
+  ALLOC(tbl->qn, int[NG][TBLNP][TBLNT], ctl->nd);
+  ALLOC(tbl->qoff, int[NG][TBLNP][TBLNT], ctl->nd);
+  ALLOC(tbl->qlu0, double[NG][TBLNP][TBLNT], ctl->nd);
+  ALLOC(tbl->qdlu, double[NG][TBLNP][TBLNT], ctl->nd);
+  ALLOC(tbl->qs0, float[NG][TBLNP][TBLNT], ctl->nd);
+  ALLOC(tbl->qa, float[NG][TBLNP][TBLNT], ctl->nd);
+  ALLOC(qbuf, unsigned short, 8 * TBLNU);
+  memset(tbl->qn, 0, (size_t) ctl->nd * sizeof(*tbl->qn));
+
+  /* Find grid size of each curve (curves are quantised into a scratch
+     buffer here and stored in the second pass)... */
+  tbl->qeps = qbuf;
+  for (int id = 0; id < ctl->nd; id++)
+    for (int ig = 0; ig < ctl->ng; ig++)
+      for (int ip = 0; ip < tbl->np[id][ig]; ip++)
+	for (int it = 0; it < tbl->nt[id][ig][ip]; it++) {
+
+	  /* Check size of curve... */
+	  const int nu = tbl->nu[id][ig][ip][it];
+	  if (nu < 2)
+	    continue;
+	  ncurve++;
+	  norg += 2 * (size_t) nu * sizeof(float);
+
+	  /* Get curve data... */
+	  const float *u = TBLU(tbl, 0, id, ig, ip, it);
+	  const float *eps = TBLEPS(tbl, 0, id, ig, ip, it);
+	  if (!(u[0] > 0))
+	    continue;
+	  const double lu0 = log(u[0]), lu1 = log(u[nu - 1]);
+
+	  /* Refine grid until error bound is met (the table points are grid
+	     points if the table is given on a regular log(u) grid)... */
+	  for (int n = nu; n <= 8 * TBLNU; n = 2 * n - 1) {
+
+	    /* Check size... */
+	    if (nq + (size_t) n > INT_MAX)
+	      ERRMSG("Too many quantised data points!");
+
+	    /* Quantise emissivity on log(u) grid... */
+	    for (int i = 0; i < n; i++) {
+	      const double ui = exp(LIN(0., lu0, n - 1., lu1, (double) i));
+	      const double e = intpol_tbl_eps(tbl, 0, ig, id, ip, it,
+					      MAX(MIN(ui, u[nu - 1]), u[0]));
+	      qbuf[i] = (unsigned short) lrint(65535. * MAX(MIN(e, 1.), 0.));
+	    }
+	    tbl->qlu0[id][ig][ip][it] = lu0;
+	    tbl->qdlu[id][ig][ip][it] = (n - 1.) / (lu1 - lu0);
+	    tbl->qs0[id][ig][ip][it] = eps[0] / u[0];
+	    tbl->qa[id][ig][ip][it] =
+	      (float) (log(1 - eps[nu - 1]) / u[nu - 1]);
+	    tbl->qoff[id][ig][ip][it] = 0;
+
+	    /* Check error at table points and midpoints... */
+	    double err = 0;
+	    for (int i = 0; i < 2 * nu - 1; i++) {
+	      const double ut =
+		(i % 2 == 0 ? u[i / 2] : 0.5 * (u[i / 2] + u[i / 2 + 1]));
+	      tbl->qn[id][ig][ip][it] = 0;
+	      const double e0 = intpol_tbl_eps(tbl, 0, ig, id, ip, it, ut);
+	      tbl->qn[id][ig][ip][it] = n;
+	      const double e1 = intpol_tbl_eps(tbl, 0, ig, id, ip, it, ut);
+	      err = MAX(err, fabs(e1 - e0));
+	    }
+
+	    /* Accept grid... */
+	    if (err <= ctl->tblqerr) {
+	      nq += (size_t) n;
+	      nquant++;
+	      errmax = MAX(errmax, err);
+	      break;
+	    }
+	    tbl->qn[id][ig][ip][it] = 0;
+	  }
+	}
+
+  /* Allocate... */
+  free(qbuf);
+  ALLOC(tbl->qeps, unsigned short, MAX(nq, 1));
+
+  /* Store quantised curves... */
+  nq = 0;
+  for (int id = 0; id < ctl->nd; id++)
+    for (int ig = 0; ig < ctl->ng; ig++)
+      for (int ip = 0; ip < tbl->np[id][ig]; ip++)
+	for (int it = 0; it < tbl->nt[id][ig][ip]; it++) {
+	  const int n = tbl->qn[id][ig][ip][it];
+	  if (n <= 0)
+	    continue;
+	  const float *u = TBLU(tbl, 0, id, ig, ip, it);
+	  const int nu = tbl->nu[id][ig][ip][it];
+	  const double lu0 = log(u[0]), lu1 = log(u[nu - 1]);
+	  tbl->qn[id][ig][ip][it] = 0;
+	  for (int i = 0; i < n; i++) {
+	    const double ui = exp(LIN(0., lu0, n - 1., lu1, (double) i));
+	    const double e = intpol_tbl_eps(tbl, 0, ig, id, ip, it,
+					    MAX(MIN(ui, u[nu - 1]), u[0]));
+	    tbl->qeps[nq + (size_t) i]
+	      = (unsigned short) lrint(65535. * MAX(MIN(e, 1.), 0.));
+	  }
+	  tbl->qn[id][ig][ip][it] = n;
+	  tbl->qoff[id][ig][ip][it] = (int) nq;
+	  nq += (size_t) n;
+	}
+
+  /* Write info... */
+  LOG(2, "Quantised curves: %d of %d | maximum error= %g (bound= %g)",
+      nquant, ncurve, errmax, ctl->tblqerr);
+  LOG(2, "Memory usage: %g MByte (original curves: %g MByte)",
+      (double) nq * sizeof(unsigned short) / 1e6, (double) norg / 1e6);
 }
 
 /*****************************************************************************/
@@ -3686,23 +4629,76 @@ void intpol_atm(
   const ctl_t *ctl,
   const atm_t *atm,
   const double z,
+  const double lon,
+  const double lat,
   double *p,
   double *t,
   double *q,
   double *k) {
 
+  /* Get number of altitude levels... */
+  const int nz = (atm->nlon > 1 || atm->nlat > 1 ? atm->nz : atm->np);
+
   /* Get array index... */
-  const int ip = locate_irr(atm->z, atm->np, z);
+  const int ip = locate_irr(atm->z, nz, z);
+
+  /* Interpolate (1D profile)... */
+  if (nz == atm->np) {
+    *p = LOGY(atm->z[ip], atm->p[ip], atm->z[ip + 1], atm->p[ip + 1], z);
+    *t = LIN(atm->z[ip], atm->t[ip], atm->z[ip + 1], atm->t[ip + 1], z);
+    for (int ig = 0; ig < ctl->ng; ig++)
+      q[ig] =
+	LIN(atm->z[ip], atm->q[ig][ip], atm->z[ip + 1], atm->q[ig][ip + 1],
+	    z);
+    for (int iw = 0; iw < ctl->nw; iw++)
+      k[iw] =
+	LIN(atm->z[ip], atm->k[iw][ip], atm->z[ip + 1], atm->k[iw][ip + 1],
+	    z);
+    return;
+  }
+
+  /* Get grid cell and weights (regular longitude-latitude grid)... */
+  int ilon = 0, ilat = 0;
+  double wlon = 0, wlat = 0;
+  if (atm->nlon > 1) {
+    const double lonc = atm->lon0 + 0.5 * (atm->nlon - 1) * atm->dlon;
+    const double x =
+      (lon - 360 * round((lon - lonc) / 360) - atm->lon0) / atm->dlon;
+    ilon = MIN(MAX((int) floor(x), 0), atm->nlon - 2);
+    wlon = MIN(MAX(x - ilon, 0), 1);
+  }
+  if (atm->nlat > 1) {
+    const double x = (lat - atm->lat0) / atm->dlat;
+    ilat = MIN(MAX((int) floor(x), 0), atm->nlat - 2);
+    wlat = MIN(MAX(x - ilat, 0), 1);
+  }
+  const int j00 = (ilon * atm->nlat + ilat) * nz + ip;
+  const int j01 = j00 + (atm->nlat > 1 ? nz : 0);
+  const int j10 = j00 + (atm->nlon > 1 ? atm->nlat * nz : 0);
+  const int jc[4] = { j00, j01, j10, j10 + j01 - j00 };
+  const double wc[4] = { (1 - wlon) * (1 - wlat), (1 - wlon) * wlat,
+    wlon * (1 - wlat), wlon * wlat
+  };
 
-  /* Interpolate... */
-  *p = LOGY(atm->z[ip], atm->p[ip], atm->z[ip + 1], atm->p[ip + 1], z);
-  *t = LIN(atm->z[ip], atm->t[ip], atm->z[ip + 1], atm->t[ip + 1], z);
+  /* Interpolate (3D grid)... */
+  *p = *t = 0;
   for (int ig = 0; ig < ctl->ng; ig++)
-    q[ig] =
-      LIN(atm->z[ip], atm->q[ig][ip], atm->z[ip + 1], atm->q[ig][ip + 1], z);
+    q[ig] = 0;
   for (int iw = 0; iw < ctl->nw; iw++)
-    k[iw] =
-      LIN(atm->z[ip], atm->k[iw][ip], atm->z[ip + 1], atm->k[iw][ip + 1], z);
+    k[iw] = 0;
+  for (int ic = 0; ic < 4; ic++) {
+    const int j = jc[ic];
+    *p += wc[ic] * LOGY(atm->z[ip], atm->p[j], atm->z[ip + 1], atm->p[j + 1],
+			z);
+    *t += wc[ic] * LIN(atm->z[ip], atm->t[j], atm->z[ip + 1], atm->t[j + 1],
+		       z);
+    for (int ig = 0; ig < ctl->ng; ig++)
+      q[ig] += wc[ic] * LIN(atm->z[ip], atm->q[ig][j], atm->z[ip + 1],
+			    atm->q[ig][j + 1], z);
+    for (int iw = 0; iw < ctl->nw; iw++)
+      k[iw] += wc[ic] * LIN(atm->z[ip], atm->k[iw][j], atm->z[ip + 1],
+			    atm->k[iw][j + 1], z);
+  }
 }
 
 /*****************************************************************************/
@@ -3710,79 +4706,74 @@ void intpol_atm(
 void intpol_tbl_cga(
   const ctl_t *ctl,
   const tbl_t *tbl,
+  const int ic,
   const los_t *los,
   const int ip,
   double tau_path[ND][NG],
   double tau_seg[ND]) {
 
-  double eps;
+  double eps, wp[ND], wt0[ND], wt1[ND];
 
-  /* Loop over channels... */
-  for (int id = 0; id < ctl->nd; id++) {
+  int ipr[ND], it0[ND], it1[ND];
 
-    /* Initialize... */
+  /* Initialize... */
+  for (int id = 0; id < ctl->nd; id++)
     tau_seg[id] = 1;
 
-    /* Loop over emitters.... */
-    for (int ig = 0; ig < ctl->ng; ig++) {
+  /* Loop over emitters.... */
+  for (int ig = 0; ig < ctl->ng; ig++) {
 
-      /* Check size of table (pressure)... */
-      if (tbl->np[id][ig] < 30)
-	eps = 0;
+    /* Get pressure and temperature indices and weights of each grid... */
+    for (int igr = 0; igr < tbl->ngrid[ig]; igr++)
+      intpol_tbl_grid(tbl, ig, tbl->idgrid[ig][igr], los->cgp[ip][ig],
+		      los->cgt[ip][ig], 1, &ipr[igr], &it0[igr], &it1[igr],
+		      &wp[igr], &wt0[igr], &wt1[igr]);
+
+    /* Loop over active channels... */
+    for (int iid = 0; iid < tbl->nad[ig]; iid++) {
+      const int id = tbl->iad[ig][iid];
+      const int igr = tbl->igrid[id][ig];
 
       /* Check transmittance... */
-      else if (tau_path[id][ig] < 1e-9)
+      if (tau_path[id][ig] < 1e-9)
 	eps = 1;
 
+      /* Check size of table (temperature and column density)... */
+      else if (tbl->nt[id][ig][ipr[igr]] < 2
+	       || tbl->nt[id][ig][ipr[igr] + 1] < 2
+	       || tbl->nu[id][ig][ipr[igr]][it0[igr]] < 2
+	       || tbl->nu[id][ig][ipr[igr]][it0[igr] + 1] < 2
+	       || tbl->nu[id][ig][ipr[igr] + 1][it1[igr]] < 2
+	       || tbl->nu[id][ig][ipr[igr] + 1][it1[igr] + 1] < 2)
+	eps = 0;
+
       /* Interpolate... */
       else {
 
-	/* Determine pressure and temperature indices... */
-	const int ipr =
-	  locate_irr(tbl->p[id][ig], tbl->np[id][ig], los->cgp[ip][ig]);
-	const int it0 = locate_reg(tbl->t[id][ig][ipr], tbl->nt[id][ig][ipr],
-				   los->cgt[ip][ig]);
-	const int it1 =
-	  locate_reg(tbl->t[id][ig][ipr + 1], tbl->nt[id][ig][ipr + 1],
-		     los->cgt[ip][ig]);
-
-	/* Check size of table (temperature and column density)... */
-	if (tbl->nt[id][ig][ipr] < 2 || tbl->nt[id][ig][ipr + 1] < 2
-	    || tbl->nu[id][ig][ipr][it0] < 2
-	    || tbl->nu[id][ig][ipr][it0 + 1] < 2
-	    || tbl->nu[id][ig][ipr + 1][it1] < 2
-	    || tbl->nu[id][ig][ipr + 1][it1 + 1] < 2)
-	  eps = 0;
-
-	else {
-
-	  /* Get emissivities of extended path... */
-	  double eps00
-	    = intpol_tbl_eps(tbl, ig, id, ipr, it0, los->cgu[ip][ig]);
-	  double eps01 =
-	    intpol_tbl_eps(tbl, ig, id, ipr, it0 + 1, los->cgu[ip][ig]);
-	  double eps10 =
-	    intpol_tbl_eps(tbl, ig, id, ipr + 1, it1, los->cgu[ip][ig]);
-	  double eps11 =
-	    intpol_tbl_eps(tbl, ig, id, ipr + 1, it1 + 1, los->cgu[ip][ig]);
-
-	  /* Interpolate with respect to temperature... */
-	  eps00 = LIN(tbl->t[id][ig][ipr][it0], eps00,
-		      tbl->t[id][ig][ipr][it0 + 1], eps01, los->cgt[ip][ig]);
-	  eps11 = LIN(tbl->t[id][ig][ipr + 1][it1], eps10,
-		      tbl->t[id][ig][ipr + 1][it1 + 1],
-		      eps11, los->cgt[ip][ig]);
-
-	  /* Interpolate with respect to pressure... */
-	  eps00 = LOGX(tbl->p[id][ig][ipr], eps00,
-		       tbl->p[id][ig][ipr + 1], eps11, los->cgp[ip][ig]);
-
-	  /* Check emssivity range... */
-	  eps00 = MAX(MIN(eps00, 1), 0);
-
-	  /* Determine segment emissivity... */
-	  eps = 1 - (1 - eps00) / tau_path[id][ig];
-	}
+	/* Get emissivities of extended path... */
+	const double eps00 =
+	  intpol_tbl_eps(tbl, ic, ig, id, ipr[igr], it0[igr],
+			 los->cgu[ip][ig]);
+	const double eps01 =
+	  intpol_tbl_eps(tbl, ic, ig, id, ipr[igr], it0[igr] + 1,
+			 los->cgu[ip][ig]);
+	const double eps10 =
+	  intpol_tbl_eps(tbl, ic, ig, id, ipr[igr] + 1, it1[igr],
+			 los->cgu[ip][ig]);
+	const double eps11 =
+	  intpol_tbl_eps(tbl, ic, ig, id, ipr[igr] + 1, it1[igr] + 1,
+			 los->cgu[ip][ig]);
+
+	/* Interpolate with respect to temperature and pressure... */
+	const double eps0 = eps00 + wt0[igr] * (eps01 - eps00);
+	const double eps1 = eps10 + wt1[igr] * (eps11 - eps10);
+	double epsp = eps0 + wp[igr] * (eps1 - eps0);
+
+	/* Check emssivity range... */
+	epsp = MAX(MIN(epsp, 1), 0);
+
+	/* Determine segment emissivity... */
+	eps = 1 - (1 - epsp) / tau_path[id][ig];
       }
 
       /* Get transmittance of extended path... */
@@ -3799,86 +4790,80 @@ void intpol_tbl_cga(
 void intpol_tbl_ega(
   const ctl_t *ctl,
   const tbl_t *tbl,
+  const int ic,
   const los_t *los,
   const int ip,
   double tau_path[ND][NG],
   double tau_seg[ND]) {
 
-  double eps, u;
+  double eps, wp[ND], wt0[ND], wt1[ND];
 
-  /* Loop over channels... */
-  for (int id = 0; id < ctl->nd; id++) {
+  int ipr[ND], it0[ND], it1[ND];
 
-    /* Initialize... */
+  /* Initialize... */
+  for (int id = 0; id < ctl->nd; id++)
     tau_seg[id] = 1;
 
-    /* Loop over emitters.... */
-    for (int ig = 0; ig < ctl->ng; ig++) {
+  /* Loop over emitters.... */
+  for (int ig = 0; ig < ctl->ng; ig++) {
 
-      /* Check size of table (pressure)... */
-      if (tbl->np[id][ig] < 30)
-	eps = 0;
+    /* Get pressure and temperature indices and weights of each grid... */
+    for (int igr = 0; igr < tbl->ngrid[ig]; igr++)
+      intpol_tbl_grid(tbl, ig, tbl->idgrid[ig][igr], los->p[ip], los->t[ip],
+		      0, &ipr[igr], &it0[igr], &it1[igr], &wp[igr], &wt0[igr],
+		      &wt1[igr]);
+
+    /* Loop over active channels... */
+    for (int iid = 0; iid < tbl->nad[ig]; iid++) {
+      const int id = tbl->iad[ig][iid];
+      const int igr = tbl->igrid[id][ig];
 
       /* Check transmittance... */
-      else if (tau_path[id][ig] < 1e-9)
+      if (tau_path[id][ig] < 1e-9)
 	eps = 1;
 
+      /* Check size of table (temperature and column density)... */
+      else if (tbl->nt[id][ig][ipr[igr]] < 2
+	       || tbl->nt[id][ig][ipr[igr] + 1] < 2
+	       || tbl->nu[id][ig][ipr[igr]][it0[igr]] < 2
+	       || tbl->nu[id][ig][ipr[igr]][it0[igr] + 1] < 2
+	       || tbl->nu[id][ig][ipr[igr] + 1][it1[igr]] < 2
+	       || tbl->nu[id][ig][ipr[igr] + 1][it1[igr] + 1] < 2)
+	eps = 0;
+
       /* Interpolate... */
       else {
 
-	/* Determine pressure and temperature indices... */
-	const int ipr =
-	  locate_irr(tbl->p[id][ig], tbl->np[id][ig], los->p[ip]);
-	const int it0 =
-	  locate_reg(tbl->t[id][ig][ipr], tbl->nt[id][ig][ipr], los->t[ip]);
-	const int it1 =
-	  locate_reg(tbl->t[id][ig][ipr + 1], tbl->nt[id][ig][ipr + 1],
-		     los->t[ip]);
-
-	/* Check size of table (temperature and column density)... */
-	if (tbl->nt[id][ig][ipr] < 2 || tbl->nt[id][ig][ipr + 1] < 2
-	    || tbl->nu[id][ig][ipr][it0] < 2
-	    || tbl->nu[id][ig][ipr][it0 + 1] < 2
-	    || tbl->nu[id][ig][ipr + 1][it1] < 2
-	    || tbl->nu[id][ig][ipr + 1][it1 + 1] < 2)
-	  eps = 0;
-
-	else {
-
-	  /* Get emissivities of extended path... */
-	  u = intpol_tbl_u(tbl, ig, id, ipr, it0, 1 - tau_path[id][ig]);
-	  double eps00
-	    = intpol_tbl_eps(tbl, ig, id, ipr, it0, u + los->u[ip][ig]);
-
-	  u = intpol_tbl_u(tbl, ig, id, ipr, it0 + 1, 1 - tau_path[id][ig]);
-	  double eps01 =
-	    intpol_tbl_eps(tbl, ig, id, ipr, it0 + 1, u + los->u[ip][ig]);
-
-	  u = intpol_tbl_u(tbl, ig, id, ipr + 1, it1, 1 - tau_path[id][ig]);
-	  double eps10 =
-	    intpol_tbl_eps(tbl, ig, id, ipr + 1, it1, u + los->u[ip][ig]);
-
-	  u =
-	    intpol_tbl_u(tbl, ig, id, ipr + 1, it1 + 1, 1 - tau_path[id][ig]);
-	  double eps11 =
-	    intpol_tbl_eps(tbl, ig, id, ipr + 1, it1 + 1, u + los->u[ip][ig]);
-
-	  /* Interpolate with respect to temperature... */
-	  eps00 = LIN(tbl->t[id][ig][ipr][it0], eps00,
-		      tbl->t[id][ig][ipr][it0 + 1], eps01, los->t[ip]);
-	  eps11 = LIN(tbl->t[id][ig][ipr + 1][it1], eps10,
-		      tbl->t[id][ig][ipr + 1][it1 + 1], eps11, los->t[ip]);
-
-	  /* Interpolate with respect to pressure... */
-	  eps00 = LIN(tbl->p[id][ig][ipr], eps00,
-		      tbl->p[id][ig][ipr + 1], eps11, los->p[ip]);
-
-	  /* Check emssivity range... */
-	  eps00 = MAX(MIN(eps00, 1), 0);
-
-	  /* Determine segment emissivity... */
-	  eps = 1 - (1 - eps00) / tau_path[id][ig];
-	}
+	/* Get emissivities of extended path... */
+	const double eps_path = 1 - tau_path[id][ig];
+	const double eps00 =
+	  intpol_tbl_eps(tbl, ic, ig, id, ipr[igr], it0[igr],
+			 intpol_tbl_u(tbl, ic, ig, id, ipr[igr], it0[igr],
+				      eps_path) + los->u[ip][ig]);
+	const double eps01 =
+	  intpol_tbl_eps(tbl, ic, ig, id, ipr[igr], it0[igr] + 1,
+			 intpol_tbl_u(tbl, ic, ig, id, ipr[igr], it0[igr] + 1,
+				      eps_path) + los->u[ip][ig]);
+	const double eps10 =
+	  intpol_tbl_eps(tbl, ic, ig, id, ipr[igr] + 1, it1[igr],
+			 intpol_tbl_u(tbl, ic, ig, id, ipr[igr] + 1, it1[igr],
+				      eps_path) + los->u[ip][ig]);
+	const double eps11 =
+	  intpol_tbl_eps(tbl, ic, ig, id, ipr[igr] + 1, it1[igr] + 1,
+			 intpol_tbl_u(tbl, ic, ig, id, ipr[igr] + 1,
+				      it1[igr] + 1, eps_path)
+			 + los->u[ip][ig]);
+
+	/* Interpolate with respect to temperature and pressure... */
+	const double eps0 = eps00 + wt0[igr] * (eps01 - eps00);
+	const double eps1 = eps10 + wt1[igr] * (eps11 - eps10);
+	double epsp = eps0 + wp[igr] * (eps1 - eps0);
+
+	/* Check emssivity range... */
+	epsp = MAX(MIN(epsp, 1), 0);
+
+	/* Determine segment emissivity... */
+	eps = 1 - (1 - epsp) / tau_path[id][ig];
       }
 
       /* Get transmittance of extended path... */
@@ -3894,22 +4879,47 @@ void intpol_tbl_ega(
 
 double intpol_tbl_eps(
   const tbl_t *tbl,
+  const int ic,
   const int ig,
   const int id,
   const int ip,
   const int it,
   const double u) {
 
+  /* Quantised table... */
+  const int nq = (tbl->qn != NULL ? tbl->qn[id][ig][ip][it] : 0);
+  if (nq > 0) {
+
+    /* Lower boundary... */
+    const double x = (log(u) - tbl->qlu0[id][ig][ip][it])
+      * tbl->qdlu[id][ig][ip][it];
+    if (!(x >= 0))
+      return tbl->qs0[id][ig][ip][it] * u;
+
+    /* Upper boundary... */
+    else if (x > nq - 1)
+      return 1 - exp(tbl->qa[id][ig][ip][it] * u);
+
+    /* Interpolation... */
+    else {
+      const unsigned short *q = tbl->qeps + tbl->qoff[id][ig][ip][it];
+      const int i = MIN((int) x, nq - 2);
+      return (q[i] + (x - i) * (q[i + 1] - q[i])) / 65535.;
+    }
+  }
+
+  /* Get table data... */
+  const float *tu = TBLU(tbl, ic, id, ig, ip, it);
+  const float *teps = TBLEPS(tbl, ic, id, ig, ip, it);
+  const int nu = tbl->nu[id][ig][ip][it];
+
   /* Lower boundary... */
-  if (u < tbl->u[id][ig][ip][it][0])
-    return LIN(0, 0, tbl->u[id][ig][ip][it][0], tbl->eps[id][ig][ip][it][0],
-	       u);
+  if (u < tu[0])
+    return LIN(0, 0, tu[0], teps[0], u);
 
   /* Upper boundary... */
-  else if (u > tbl->u[id][ig][ip][it][tbl->nu[id][ig][ip][it] - 1]) {
-    const double a =
-      log(1 - tbl->eps[id][ig][ip][it][tbl->nu[id][ig][ip][it] - 1])
-      / tbl->u[id][ig][ip][it][tbl->nu[id][ig][ip][it] - 1];
+  else if (u > tu[nu - 1]) {
+    const double a = log(1 - teps[nu - 1]) / tu[nu - 1];
     return 1 - exp(a * u);
   }
 
@@ -3917,14 +4927,160 @@ double intpol_tbl_eps(
   else {
 
     /* Get index... */
-    const int idx =
-      locate_tbl(tbl->u[id][ig][ip][it], tbl->nu[id][ig][ip][it], u);
+    const int idx = locate_tbl(tu, nu, u);
 
     /* Interpolate... */
-    return
-      LIN(tbl->u[id][ig][ip][it][idx], tbl->eps[id][ig][ip][it][idx],
-	  tbl->u[id][ig][ip][it][idx + 1], tbl->eps[id][ig][ip][it][idx + 1],
-	  u);
+    return LIN(tu[idx], teps[idx], tu[idx + 1], teps[idx + 1], u);
+  }
+}
+
+/*****************************************************************************/
+
+void intpol_tbl_grid(
+  const tbl_t *tbl,
+  const int ig,
+  const int id,
+  const double p,
+  const double t,
+  const int logp,
+  int *ipr,
+  int *it0,
+  int *it1,
+  double *wp,
+  double *wt0,
+  double *wt1) {
+
+  /* Determine pressure and temperature indices... */
+  *ipr = locate_irr(tbl->p[id][ig], tbl->np[id][ig], p);
+  *it0 = locate_reg(tbl->t[id][ig][*ipr], tbl->nt[id][ig][*ipr], t);
+  *it1 = locate_reg(tbl->t[id][ig][*ipr + 1], tbl->nt[id][ig][*ipr + 1], t);
+
+  /* Get temperature weights... */
+  const double *t0 = tbl->t[id][ig][*ipr], *t1 = tbl->t[id][ig][*ipr + 1];
+  *wt0 = (t - t0[*it0]) / (t0[*it0 + 1] - t0[*it0]);
+  *wt1 = (t - t1[*it1]) / (t1[*it1 + 1] - t1[*it1]);
+
+  /* Get pressure weight (logarithmic or linear)... */
+  const double p0 = tbl->p[id][ig][*ipr], p1 = tbl->p[id][ig][*ipr + 1];
+  if (logp && p / p0 > 0 && p1 / p0 > 0)
+    *wp = log(p / p0) / log(p1 / p0);
+  else
+    *wp = (p - p0) / (p1 - p0);
+}
+
+/*****************************************************************************/
+
+void intpol_tbl_nadir(
+  const ctl_t *ctl,
+  const tbl_t *tbl,
+  const int ic,
+  const los_t *los,
+  const int ip,
+  const int nr,
+  double u[NR][NG],
+  double cgu[NR][NG],
+  double tau_path[NR][ND][NG],
+  double tau_seg[NR][ND]) {
+
+  /* Loop over channels... */
+  for (int id = 0; id < ctl->nd; id++) {
+
+    /* Initialize... */
+    for (int ir = 0; ir < nr; ir++)
+      tau_seg[ir][id] = 1;
+
+    /* Loop over active emitters.... */
+    for (int iig = 0; iig < tbl->nag[id]; iig++) {
+      const int ig = tbl->iag[id][iig];
+
+      /* Get pressure and temperature (common for all rays)... */
+      const double p = (ctl->formod == 0 ? los->cgp[ip][ig] : los->p[ip]);
+      const double t = (ctl->formod == 0 ? los->cgt[ip][ig] : los->t[ip]);
+
+      /* Determine pressure and temperature indices... */
+      const int ipr = locate_irr(tbl->p[id][ig], tbl->np[id][ig], p);
+      const int it0 = locate_reg(tbl->t[id][ig][ipr], tbl->nt[id][ig][ipr], t);
+      const int it1 =
+	locate_reg(tbl->t[id][ig][ipr + 1], tbl->nt[id][ig][ipr + 1], t);
+
+      /* Check size of table (temperature and column density)... */
+      const int empty = (tbl->nt[id][ig][ipr] < 2
+			 || tbl->nt[id][ig][ipr + 1] < 2
+			 || tbl->nu[id][ig][ipr][it0] < 2
+			 || tbl->nu[id][ig][ipr][it0 + 1] < 2
+			 || tbl->nu[id][ig][ipr + 1][it1] < 2
+			 || tbl->nu[id][ig][ipr + 1][it1 + 1] < 2);
+
+      /* Loop over rays... */
+      for (int ir = 0; ir < nr; ir++) {
+
+	double eps, eps00, eps01, eps10, eps11;
+
+	/* Check transmittance... */
+	if (tau_path[ir][id][ig] < 1e-9)
+	  eps = 1;
+
+	/* Check size of table... */
+	else if (empty)
+	  eps = 0;
+
+	/* Interpolate... */
+	else {
+
+	  /* Get emissivities of extended path (CGA)... */
+	  if (ctl->formod == 0) {
+	    eps00 = intpol_tbl_eps(tbl, ic, ig, id, ipr, it0, cgu[ir][ig]);
+	    eps01 = intpol_tbl_eps(tbl, ic, ig, id, ipr, it0 + 1, cgu[ir][ig]);
+	    eps10 = intpol_tbl_eps(tbl, ic, ig, id, ipr + 1, it1, cgu[ir][ig]);
+	    eps11 =
+	      intpol_tbl_eps(tbl, ic, ig, id, ipr + 1, it1 + 1, cgu[ir][ig]);
+	  }
+
+	  /* Get emissivities of extended path (EGA)... */
+	  else {
+	    const double eps_path = 1 - tau_path[ir][id][ig];
+	    eps00 = intpol_tbl_eps(tbl, ic, ig, id, ipr, it0,
+				   intpol_tbl_u(tbl, ic, ig, id, ipr, it0,
+						eps_path) + u[ir][ig]);
+	    eps01 = intpol_tbl_eps(tbl, ic, ig, id, ipr, it0 + 1,
+				   intpol_tbl_u(tbl, ic, ig, id, ipr, it0 + 1,
+						eps_path) + u[ir][ig]);
+	    eps10 = intpol_tbl_eps(tbl, ic, ig, id, ipr + 1, it1,
+				   intpol_tbl_u(tbl, ic, ig, id, ipr + 1, it1,
+						eps_path) + u[ir][ig]);
+	    eps11 = intpol_tbl_eps(tbl, ic, ig, id, ipr + 1, it1 + 1,
+				   intpol_tbl_u(tbl, ic, ig, id, ipr + 1,
+						it1 + 1, eps_path) + u[ir][ig]);
+	  }
+
+	  /* Interpolate with respect to temperature... */
+	  eps00 = LIN(tbl->t[id][ig][ipr][it0], eps00,
+		      tbl->t[id][ig][ipr][it0 + 1], eps01, t);
+	  eps11 = LIN(tbl->t[id][ig][ipr + 1][it1], eps10,
+		      tbl->t[id][ig][ipr + 1][it1 + 1], eps11, t);
+
+	  /* Interpolate with respect to pressure... */
+	  if (ctl->formod == 0)
+	    eps00 = LOGX(tbl->p[id][ig][ipr], eps00,
+			 tbl->p[id][ig][ipr + 1], eps11, p);
+	  else
+	    eps00 = LIN(tbl->p[id][ig][ipr], eps00,
+			tbl->p[id][ig][ipr + 1], eps11, p);
+
+	  /* Check emssivity range... */
+	  eps00 = MAX(MIN(eps00, 1), 0);
+
+	  /* Determine segment emissivity... */
+	  eps = 1 - (1 - eps00) / tau_path[ir][id][ig];
+	}
+
+	/* Get transmittance of extended path... */
+	tau_path[ir][id][ig] *= (1 - eps);
+
+	/* Get segment transmittance... */
+	tau_seg[ir][id] *= (1 - eps);
+      }
+    }
   }
 }
 
@@ -3932,22 +5088,61 @@ double intpol_tbl_eps(
 
 double intpol_tbl_u(
   const tbl_t *tbl,
+  const int ic,
   const int ig,
   const int id,
   const int ip,
   const int it,
   const double eps) {
 
+  /* Quantised table (invert the quantised curve to be consistent
+     with intpol_tbl_eps)... */
+  const int nq = (tbl->qn != NULL ? tbl->qn[id][ig][ip][it] : 0);
+  if (nq > 0) {
+
+    /* Get table data... */
+    const unsigned short *q = tbl->qeps + tbl->qoff[id][ig][ip][it];
+    const double e = 65535. * eps;
+
+    /* Lower boundary... */
+    if (e < q[0])
+      return eps / tbl->qs0[id][ig][ip][it];
+
+    /* Upper boundary... */
+    else if (e >= q[nq - 1])
+      return log(1 - eps) / tbl->qa[id][ig][ip][it];
+
+    /* Interpolation... */
+    else {
+
+      /* Get index (binary search)... */
+      int ilo = 0, ihi = nq - 1;
+      while (ihi > ilo + 1) {
+	const int i = (ihi + ilo) >> 1;
+	if (q[i] > e)
+	  ihi = i;
+	else
+	  ilo = i;
+      }
+
+      /* Interpolate... */
+      const double x = ilo + (e - q[ilo]) / (q[ilo + 1] - q[ilo]);
+      return exp(tbl->qlu0[id][ig][ip][it] + x / tbl->qdlu[id][ig][ip][it]);
+    }
+  }
+
+  /* Get table data... */
+  const float *tu = TBLU(tbl, ic, id, ig, ip, it);
+  const float *teps = TBLEPS(tbl, ic, id, ig, ip, it);
+  const int nu = tbl->nu[id][ig][ip][it];
+
   /* Lower boundary... */
-  if (eps < tbl->eps[id][ig][ip][it][0])
-    return LIN(0, 0, tbl->eps[id][ig][ip][it][0], tbl->u[id][ig][ip][it][0],
-	       eps);
+  if (eps < teps[0])
+    return LIN(0, 0, teps[0], tu[0], eps);
 
   /* Upper boundary... */
-  else if (eps > tbl->eps[id][ig][ip][it][tbl->nu[id][ig][ip][it] - 1]) {
-    const double a =
-      log(1 - tbl->eps[id][ig][ip][it][tbl->nu[id][ig][ip][it] - 1])
-      / tbl->u[id][ig][ip][it][tbl->nu[id][ig][ip][it] - 1];
+  else if (eps > teps[nu - 1]) {
+    const double a = log(1 - teps[nu - 1]) / tu[nu - 1];
     return log(1 - eps) / a;
   }
 
@@ -3955,14 +5150,10 @@ double intpol_tbl_u(
   else {
 
     /* Get index... */
-    const int idx =
-      locate_tbl(tbl->eps[id][ig][ip][it], tbl->nu[id][ig][ip][it], eps);
+    const int idx = locate_tbl(teps, nu, eps);
 
     /* Interpolate... */
-    return
-      LIN(tbl->eps[id][ig][ip][it][idx], tbl->u[id][ig][ip][it][idx],
-	  tbl->eps[id][ig][ip][it][idx + 1], tbl->u[id][ig][ip][it][idx + 1],
-	  eps);
+    return LIN(teps[idx], tu[idx], teps[idx + 1], tu[idx + 1], eps);
   }
 }
 
@@ -4007,9 +5198,6 @@ void kernel(
   obs_t *obs,
   gsl_matrix *k) {
 
-  atm_t *atm1;
-  obs_t *obs1;
-
   int *iqa;
 
   /* Get sizes... */
@@ -4033,69 +5221,200 @@ void kernel(
   gsl_matrix_set_zero(k);
 
   /* Loop over state vector elements... */
-#pragma omp parallel for default(none) shared(ctl,atm,obs,k,x0,yy0,n,m,iqa) private(atm1, obs1)
+#pragma omp parallel for default(none) shared(ctl,atm,obs,k,x0,yy0,n,iqa)
   for (size_t j = 0; j < n; j++) {
 
-    /* Allocate... */
-    gsl_vector *x1 = gsl_vector_alloc(n);
-    gsl_vector *yy1 = gsl_vector_alloc(m);
-    ALLOC(atm1, atm_t, 1);
-    ALLOC(obs1, obs_t, 1);
-
-    /* Set perturbation size... */
-    double h;
-    if (iqa[j] == IDXP)
-      h = MAX(fabs(0.01 * gsl_vector_get(x0, j)), 1e-7);
-    else if (iqa[j] == IDXT)
-      h = 1.0;
-    else if (iqa[j] >= IDXQ(0) && iqa[j] < IDXQ(ctl->ng))
-      h = MAX(fabs(0.01 * gsl_vector_get(x0, j)), 1e-15);
-    else if (iqa[j] >= IDXK(0) && iqa[j] < IDXK(ctl->nw))
-      h = 1e-4;
-    else if (iqa[j] == IDXCLZ || iqa[j] == IDXCLDZ)
-      h = 1.0;
-    else if (iqa[j] >= IDXCLK(0) && iqa[j] < IDXCLK(ctl->ncl))
-      h = 1e-4;
-    else if (iqa[j] == IDXSFZ)
-      h = 0.1;
-    else if (iqa[j] == IDXSFP)
-      h = 10.0;
-    else if (iqa[j] == IDXSFT)
-      h = 1.0;
-    else if (iqa[j] >= IDXSFEPS(0) && iqa[j] < IDXSFEPS(ctl->nsf))
-      h = 1e-2;
-    else
-      ERRMSG("Cannot set perturbation size!");
+    /* Compute column of kernel matrix... */
+    gsl_vector_view kj = gsl_matrix_column(k, j);
+    kernel_column(ctl, atm, obs, x0, yy0, iqa[j], j, &kj.vector);
+  }
+
+  /* Free... */
+  gsl_vector_free(x0);
+  gsl_vector_free(yy0);
+  free(iqa);
+}
+
+/*****************************************************************************/
+
+void kernel_column(
+  ctl_t *ctl,
+  atm_t *atm,
+  obs_t *obs,
+  const gsl_vector *x0,
+  const gsl_vector *yy0,
+  const int iq,
+  const size_t j,
+  gsl_vector *kj) {
+
+  atm_t *atm1;
+  obs_t *obs1;
+
+  /* Allocate... */
+  gsl_vector *x1 = gsl_vector_alloc(x0->size);
+  ALLOC(atm1, atm_t, 1);
+  ALLOC(obs1, obs_t, 1);
+
+  /* Set perturbation size... */
+  const double h = kernel_pert(ctl, iq, gsl_vector_get(x0, j));
+
+  /* Disturb state vector element... */
+  gsl_vector_memcpy(x1, x0);
+  gsl_vector_set(x1, j, gsl_vector_get(x1, j) + h);
+  copy_atm(ctl, atm1, atm, 0);
+  copy_obs(ctl, obs1, obs, 0);
+  x2atm(ctl, x1, atm1);
+
+  /* Compute radiance for disturbed atmospheric data... */
+  formod(ctl, atm1, obs1);
+
+  /* Compose measurement vector for disturbed radiance data... */
+  obs2y(ctl, obs1, kj, NULL, NULL);
+
+  /* Compute derivatives... */
+  for (size_t i = 0; i < kj->size; i++)
+    gsl_vector_set(kj, i, (gsl_vector_get(kj, i) - gsl_vector_get(yy0, i))
+		   / h);
+
+  /* Free... */
+  gsl_vector_free(x1);
+  free(atm1);
+  free(obs1);
+}
+
+/*****************************************************************************/
+
+double kernel_pert(
+  const ctl_t *ctl,
+  const int iq,
+  const double x) {
+
+  /* Set perturbation size... */
+  if (iq == IDXP)
+    return MAX(fabs(0.01 * x), 1e-7);
+  else if (iq == IDXT)
+    return 1.0;
+  else if (iq >= IDXQ(0) && iq < IDXQ(ctl->ng))
+    return MAX(fabs(0.01 * x), 1e-15);
+  else if (iq >= IDXK(0) && iq < IDXK(ctl->nw))
+    return 1e-4;
+  else if (iq == IDXCLZ || iq == IDXCLDZ)
+    return 1.0;
+  else if (iq >= IDXCLK(0) && iq < IDXCLK(ctl->ncl))
+    return 1e-4;
+  else if (iq == IDXSFZ)
+    return 0.1;
+  else if (iq == IDXSFP)
+    return 10.0;
+  else if (iq == IDXSFT)
+    return 1.0;
+  else if (iq >= IDXSFEPS(0) && iq < IDXSFEPS(ctl->nsf))
+    return 1e-2;
+  else
+    ERRMSG("Cannot set perturbation size!");
+
+  return 0;
+}
+
+/*****************************************************************************/
+
+gsl_spmatrix *kernel_sparse(
+  ctl_t *ctl,
+  atm_t *atm,
+  obs_t *obs,
+  const double droptol) {
+
+  double **val;
+
+  int *iqa, **row, *nnz;
+
+  size_t nz = 0;
+
+  /* Get sizes... */
+  const size_t m = obs2y(ctl, obs, NULL, NULL, NULL);
+  const size_t n = atm2x(ctl, atm, NULL, NULL, NULL);
+
+  /* Allocate... */
+  gsl_vector *x0 = gsl_vector_alloc(n);
+  gsl_vector *yy0 = gsl_vector_alloc(m);
+  ALLOC(iqa, int,
+	N);
+  ALLOC(nnz, int,
+	n);
+  ALLOC(row, int *,
+	n);
+  ALLOC(val, double *,
+	n);
+
+  /* Compute radiance for undisturbed atmospheric data... */
+  formod(ctl, atm, obs);
 
-    /* Disturb state vector element... */
-    gsl_vector_memcpy(x1, x0);
-    gsl_vector_set(x1, j, gsl_vector_get(x1, j) + h);
-    copy_atm(ctl, atm1, atm, 0);
-    copy_obs(ctl, obs1, obs, 0);
-    x2atm(ctl, x1, atm1);
+  /* Compose vectors... */
+  atm2x(ctl, atm, x0, iqa, NULL);
+  obs2y(ctl, obs, yy0, NULL, NULL);
 
-    /* Compute radiance for disturbed atmospheric data... */
-    formod(ctl, atm1, obs1);
+  /* Loop over state vector elements... */
+#pragma omp parallel for default(none) shared(ctl,atm,obs,x0,yy0,n,m,iqa,nnz,row,val,droptol)
+  for (size_t j = 0; j < n; j++) {
 
-    /* Compose measurement vector for disturbed radiance data... */
-    obs2y(ctl, obs1, yy1, NULL, NULL);
+    /* Compute column of kernel matrix... */
+    gsl_vector *yy1 = gsl_vector_alloc(m);
+    kernel_column(ctl, atm, obs, x0, yy0, iqa[j], j, yy1);
+    double kmax = 0;
+    for (size_t i = 0; i < m; i++)
+      kmax = MAX(kmax, fabs(gsl_vector_get(yy1, i)));
 
-    /* Compute derivatives... */
+    /* Keep elements above drop tolerance (relative to column maximum)... */
+    nnz[j] = 0;
     for (size_t i = 0; i < m; i++)
-      gsl_matrix_set(k, i, j,
-		     (gsl_vector_get(yy1, i) - gsl_vector_get(yy0, i)) / h);
+      if (fabs(gsl_vector_get(yy1, i)) > droptol * kmax)
+	nnz[j]++;
+    ALLOC(row[j], int,
+	  MAX(nnz[j], 1));
+    ALLOC(val[j], double,
+	  MAX(nnz[j], 1));
+    nnz[j] = 0;
+    for (size_t i = 0; i < m; i++)
+      if (fabs(gsl_vector_get(yy1, i)) > droptol * kmax) {
+	row[j][nnz[j]] = (int) i;
+	val[j][nnz[j]] = gsl_vector_get(yy1, i);
+	nnz[j]++;
+      }
 
     /* Free... */
-    gsl_vector_free(x1);
     gsl_vector_free(yy1);
-    free(atm1);
-    free(obs1);
   }
 
+  /* Collect matrix elements... */
+  for (size_t j = 0; j < n; j++)
+    nz += (size_t) nnz[j];
+  gsl_spmatrix *coo =
+    gsl_spmatrix_alloc_nzmax(m, n, MAX(nz, 1), GSL_SPMATRIX_COO);
+  for (size_t j = 0; j < n; j++)
+    for (int k = 0; k < nnz[j]; k++)
+      gsl_spmatrix_set(coo, (size_t) row[j][k], j, val[j][k]);
+
+  /* Convert to compressed row format... */
+  gsl_spmatrix *k = gsl_spmatrix_compress(coo, GSL_SPMATRIX_CSR);
+
+  /* Write info... */
+  LOG(2, "Sparse kernel matrix: nnz= %d of %d (%.1f%%)", (int) nz,
+      (int) (m * n), 100. * (double) nz / (double) (m * n));
+
   /* Free... */
+  gsl_spmatrix_free(coo);
+  for (size_t j = 0; j < n; j++) {
+    free(row[j]);
+    free(val[j]);
+  }
+  free(row);
+  free(val);
+  free(nnz);
   gsl_vector_free(x0);
   gsl_vector_free(yy0);
   free(iqa);
+
+  return k;
 }
 
 /*****************************************************************************/
@@ -4196,81 +5515,25 @@ size_t obs2y(
   return m;
 }
 
-/*****************************************************************************/
-
-void raytrace(
-  const ctl_t *ctl,
-  const atm_t *atm,
-  obs_t *obs,
-  los_t *los,
-  const int ir) {
-
-  const double h = 0.02, zrefrac = 60;
-
-  double ex0[3], ex1[3], k[NW], lat, lon, n, ng[3], norm, p, q[NG], t,
-    x[3], xh[3], xobs[3], xvp[3], z = 1e99, zmax, zmin;
-
-  int stop = 0;
-
-  /* Initialize... */
-  los->np = 0;
-  los->sft = -999;
-  obs->tpz[ir] = obs->vpz[ir];
-  obs->tplon[ir] = obs->vplon[ir];
-  obs->tplat[ir] = obs->vplat[ir];
-
-  /* Get altitude range of atmospheric data... */
-  gsl_stats_minmax(&zmin, &zmax, atm->z, 1, (size_t) atm->np);
-  if (ctl->nsf > 0) {
-    zmin = MAX(atm->sfz, zmin);
-    if (atm->sfp > 0) {
-      const int ip = locate_irr(atm->p, atm->np, atm->sfp);
-      const double zip =
-	LIN(log(atm->p[ip]), atm->z[ip], log(atm->p[ip + 1]), atm->z[ip + 1],
-	    log(atm->sfp));
-      zmin = MAX(zip, zmin);
-    }
-  }
-
-  /* Check observer altitude... */
-  if (obs->obsz[ir] < zmin)
-    ERRMSG("Observer below surface!");
+/*****************************************************************************/
 
-  /* Check view point altitude... */
-  if (obs->vpz[ir] > zmax)
-    return;
+void raytrace(
+  const ctl_t *ctl,
+  const atm_t *atm,
+  obs_t *obs,
+  los_t *los,
+  const int ir) {
 
-  /* Determine Cartesian coordinates for observer and view point... */
-  geo2cart(obs->obsz[ir], obs->obslon[ir], obs->obslat[ir], xobs);
-  geo2cart(obs->vpz[ir], obs->vplon[ir], obs->vplat[ir], xvp);
+  const double h = 0.02, zrefrac = 60;
 
-  /* Determine initial tangent vector... */
-  for (int i = 0; i < 3; i++)
-    ex0[i] = xvp[i] - xobs[i];
-  norm = NORM(ex0);
-  for (int i = 0; i < 3; i++)
-    ex0[i] /= norm;
+  double ex0[3], ex1[3], k[NW], lat, lon, n, ng[3], norm, p, q[NG], t,
+    x[3], xh[3], z, zmax, zmin;
 
-  /* Observer within atmosphere... */
-  for (int i = 0; i < 3; i++)
-    x[i] = xobs[i];
+  int stop;
 
-  /* Observer above atmosphere (search entry point)... */
-  if (obs->obsz[ir] > zmax) {
-    double dmax = norm, dmin = 0;
-    while (fabs(dmin - dmax) > 0.001) {
-      const double d = (dmax + dmin) / 2;
-      for (int i = 0; i < 3; i++)
-	x[i] = xobs[i] + d * ex0[i];
-      cart2geo(x, &z, &lon, &lat);
-      if (z <= zmax && z > zmax - 0.001)
-	break;
-      if (z < zmax - 0.0005)
-	dmax = d;
-      else
-	dmin = d;
-    }
-  }
+  /* Initialize ray... */
+  if (!raytrace_init(ctl, atm, obs, los, ir, &zmin, &zmax, x, ex0))
+    return;
 
   /* Ray-tracing... */
   while (1) {
@@ -4289,74 +5552,10 @@ void raytrace(
     /* Determine geolocation... */
     cart2geo(x, &z, &lon, &lat);
 
-    /* Check if LOS hits the ground or has left atmosphere... */
-    if (z < zmin || z > zmax) {
-      stop = (z < zmin ? 2 : 1);
-      const double frac =
-	((z <
-	  zmin ? zmin : zmax) - los->z[los->np - 1]) / (z - los->z[los->np -
-								   1]);
-      geo2cart(los->z[los->np - 1], los->lon[los->np - 1],
-	       los->lat[los->np - 1], xh);
-      for (int i = 0; i < 3; i++)
-	x[i] = xh[i] + frac * (x[i] - xh[i]);
-      cart2geo(x, &z, &lon, &lat);
-      los->ds[los->np - 1] = ds * frac;
-      ds = 0;
-    }
-
-    /* Interpolate atmospheric data... */
-    intpol_atm(ctl, atm, z, &p, &t, q, k);
-
-    /* Save data... */
-    los->lon[los->np] = lon;
-    los->lat[los->np] = lat;
-    los->z[los->np] = z;
-    los->p[los->np] = p;
-    los->t[los->np] = t;
-    for (int ig = 0; ig < ctl->ng; ig++)
-      los->q[los->np][ig] = q[ig];
-    for (int id = 0; id < ctl->nd; id++)
-      los->k[los->np][id] = k[ctl->window[id]];
-    los->ds[los->np] = ds;
-
-    /* Add cloud extinction... */
-    if (ctl->ncl > 0 && atm->cldz > 0) {
-      const double aux = exp(-0.5 * POW2((z - atm->clz) / atm->cldz));
-      for (int id = 0; id < ctl->nd; id++) {
-	const int icl = locate_irr(ctl->clnu, ctl->ncl, ctl->nu[id]);
-	los->k[los->np][id]
-	  += aux * LIN(ctl->clnu[icl], atm->clk[icl],
-		       ctl->clnu[icl + 1], atm->clk[icl + 1], ctl->nu[id]);
-      }
-    }
-
-    /* Increment and check number of LOS points... */
-    if ((++los->np) > NLOS)
-      ERRMSG("Too many LOS points!");
-
-    /* Check stop flag... */
-    if (stop) {
-
-      /* Set surface temperature... */
-      if (ctl->nsf > 0 && atm->sft > 0)
-	t = atm->sft;
-      los->sft = (stop == 2 ? t : -999);
-
-      /* Set surface emissivity... */
-      for (int id = 0; id < ctl->nd; id++) {
-	los->sfeps[id] = 1.0;
-	if (ctl->nsf > 0) {
-	  const int isf = locate_irr(ctl->sfnu, ctl->nsf, ctl->nu[id]);
-	  los->sfeps[id] = LIN(ctl->sfnu[isf], atm->sfeps[isf],
-			       ctl->sfnu[isf + 1], atm->sfeps[isf + 1],
-			       ctl->nu[id]);
-	}
-      }
-
-      /* Leave raytracer... */
+    /* Add LOS point and check stop flag... */
+    if ((stop = raytrace_point(ctl, atm, los, zmin, zmax, x, &z, &lon, &lat,
+			       &ds, &p, &t)))
       break;
-    }
 
     /* Determine refractivity... */
     if (ctl->refrac && z <= zrefrac)
@@ -4373,12 +5572,12 @@ void raytrace(
       for (int i = 0; i < 3; i++)
 	xh[i] = x[i] + 0.5 * ds * ex0[i];
       cart2geo(xh, &z, &lon, &lat);
-      intpol_atm(ctl, atm, z, &p, &t, q, k);
+      intpol_atm(ctl, atm, z, lon, lat, &p, &t, q, k);
       n = REFRAC(p, t);
       for (int i = 0; i < 3; i++) {
 	xh[i] += h;
 	cart2geo(xh, &z, &lon, &lat);
-	intpol_atm(ctl, atm, z, &p, &t, q, k);
+	intpol_atm(ctl, atm, z, lon, lat, &p, &t, q, k);
 	ng[i] = (REFRAC(p, t) - n) / h;
 	xh[i] -= h;
       }
@@ -4404,6 +5603,184 @@ void raytrace(
       ex0[i] = ex1[i];
   }
 
+  /* Finalize LOS... */
+  raytrace_finalize(ctl, atm, obs, los, ir, stop);
+}
+
+/*****************************************************************************/
+
+void raytrace_batch(
+  const ctl_t *ctl,
+  const atm_t *atm,
+  obs_t *obs,
+  los_t *los,
+  const int ir0,
+  const int nb) {
+
+  const double h = 0.02, zrefrac = 60;
+
+  double ds[NBATCH], ex0[3][NBATCH], ex1[3][NBATCH], k[NW], lat[NBATCH],
+    lath[4][NBATCH], lon[NBATCH], lonh[4][NBATCH], n[NBATCH],
+    ng[3][NBATCH], nh[4][NBATCH], p[NBATCH], q[NG], t[NBATCH], x[3][NBATCH],
+    xb[3], xe[3], xh[4][3][NBATCH], z[NBATCH], zh[4][NBATCH], zmax, zmin;
+
+  int active[NBATCH], iz[4][NBATCH], nact = 0;
+
+  /* Check number of rays... */
+  if (nb < 1 || nb > NBATCH)
+    ERRMSG("Number of rays per batch out of range!");
+
+  /* Initialize rays (inactive rays are parked at a dummy position)... */
+  for (int b = 0; b < nb; b++) {
+    active[b] = raytrace_init(ctl, atm, obs, &los[b], ir0 + b, &zmin, &zmax,
+			      xb, xe);
+    nact += active[b];
+    for (int i = 0; i < 3; i++) {
+      x[i][b] = (active[b] ? xb[i] : (i == 0 ? RE : 0));
+      ex0[i][b] = (active[b] ? xe[i] : (i == 0 ? 1 : 0));
+    }
+  }
+
+  /* Ray-tracing... */
+  while (nact > 0) {
+
+    /* Set step length (inactive rays do not move)... */
+#pragma omp simd
+    for (int b = 0; b < nb; b++) {
+      double step = ctl->rayds;
+      if (ctl->raydz > 0) {
+	const double norm =
+	  sqrt(x[0][b] * x[0][b] + x[1][b] * x[1][b] + x[2][b] * x[2][b]);
+	const double cosa = fabs(ex0[0][b] * (x[0][b] / norm)
+				 + ex0[1][b] * (x[1][b] / norm)
+				 + ex0[2][b] * (x[2][b] / norm));
+	if (cosa != 0)
+	  step = MIN(ctl->rayds, ctl->raydz / cosa);
+      }
+      ds[b] = (active[b] ? step : 0);
+    }
+
+    /* Determine geolocation... */
+    vec_cart2geo(nb, x[0], x[1], x[2], z, lon, lat);
+
+    /* Add LOS points and check stop flags... */
+    int nrefrac = 0;
+    for (int b = 0; b < nb; b++) {
+      n[b] = 1;
+      if (!active[b])
+	continue;
+      for (int i = 0; i < 3; i++)
+	xb[i] = x[i][b];
+      const int stop =
+	raytrace_point(ctl, atm, &los[b], zmin, zmax, xb, &z[b], &lon[b],
+		       &lat[b], &ds[b], &p[b], &t[b]);
+      if (stop) {
+	raytrace_finalize(ctl, atm, obs, &los[b], ir0 + b, stop);
+	active[b] = 0;
+	ds[b] = 0;
+	nact--;
+      } else if (ctl->refrac && z[b] <= zrefrac) {
+	n[b] = 1 + REFRAC(p[b], t[b]);
+	nrefrac++;
+      }
+    }
+
+    /* Compute gradient of refractivity... */
+    for (int i = 0; i < 3; i++)
+      for (int b = 0; b < nb; b++)
+	ng[i][b] = 0;
+    if (nrefrac > 0) {
+
+      /* Get sampling points (same rounding as in raytrace)... */
+#pragma omp simd
+      for (int b = 0; b < nb; b++)
+	for (int i = 0; i < 3; i++) {
+	  const double xm = x[i][b] + 0.5 * ds[b] * ex0[i][b];
+	  const double xp = xm + h;
+	  for (int j = 0; j < 4; j++)
+	    xh[j][i][b] = (j == i + 1 ? xp : (j > i + 1 ? xp - h : xm));
+	}
+
+      /* Determine geolocation of sampling points... */
+      for (int j = 0; j < 4; j++)
+	vec_cart2geo(nb, xh[j][0], xh[j][1], xh[j][2], zh[j], lonh[j],
+		     lath[j]);
+
+      /* Interpolate refractivity (3D grid)... */
+      if (atm->nlon > 1 || atm->nlat > 1) {
+	for (int b = 0; b < nb; b++)
+	  for (int j = 0; j < 4 && active[b] && z[b] <= zrefrac; j++) {
+	    intpol_atm(ctl, atm, zh[j][b], lonh[j][b], lath[j][b], &p[b],
+		       &t[b], q, k);
+	    nh[j][b] = REFRAC(p[b], t[b]);
+	  }
+      }
+
+      /* Interpolate refractivity (1D profile, p and T only)... */
+      else {
+	for (int j = 0; j < 4; j++)
+	  for (int b = 0; b < nb; b++)
+	    iz[j][b] = locate_irr(atm->z, atm->np, zh[j][b]);
+	for (int j = 0; j < 4; j++) {
+#pragma omp simd
+	  for (int b = 0; b < nb; b++) {
+	    const int i = iz[j][b];
+	    const double ph = LOGY(atm->z[i], atm->p[i], atm->z[i + 1],
+				   atm->p[i + 1], zh[j][b]);
+	    const double th = LIN(atm->z[i], atm->t[i], atm->z[i + 1],
+				  atm->t[i + 1], zh[j][b]);
+	    nh[j][b] = REFRAC(ph, th);
+	  }
+	}
+      }
+
+      /* Get gradient... */
+      for (int b = 0; b < nb; b++)
+	if (active[b] && ctl->refrac && z[b] <= zrefrac)
+	  for (int i = 0; i < 3; i++)
+	    ng[i][b] = (nh[i + 1][b] - nh[0][b]) / h;
+    }
+
+    /* Construct new tangent vectors and determine next points of LOS... */
+#pragma omp simd
+    for (int b = 0; b < nb; b++) {
+      for (int i = 0; i < 3; i++)
+	ex1[i][b] = ex0[i][b] * n[b] + ds[b] * ng[i][b];
+      const double norm = sqrt(ex1[0][b] * ex1[0][b] + ex1[1][b] * ex1[1][b]
+			       + ex1[2][b] * ex1[2][b]);
+      for (int i = 0; i < 3; i++) {
+	ex1[i][b] /= norm;
+	x[i][b] += 0.5 * ds[b] * (ex0[i][b] + ex1[i][b]);
+	ex0[i][b] = ex1[i][b];
+      }
+    }
+  }
+}
+
+/*****************************************************************************/
+
+void raytrace_finalize(
+  const ctl_t *ctl,
+  const atm_t *atm,
+  obs_t *obs,
+  los_t *los,
+  const int ir,
+  const int stop) {
+
+  /* Set surface temperature... */
+  los->sft = (stop == 2 ? (ctl->nsf > 0 && atm->sft > 0
+			   ? atm->sft : los->t[los->np - 1]) : -999);
+
+  /* Set surface emissivity... */
+  for (int id = 0; id < ctl->nd; id++) {
+    los->sfeps[id] = 1.0;
+    if (ctl->nsf > 0) {
+      const int isf = ctl->sfidx[id];
+      los->sfeps[id] = atm->sfeps[isf] + ctl->sfw[id]
+	* (atm->sfeps[isf + 1] - atm->sfeps[isf]);
+    }
+  }
+
   /* Get tangent point (to be done before changing segment lengths!)... */
   tangent_point(los, &obs->tpz[ir], &obs->tplon[ir], &obs->tplat[ir]);
 
@@ -4439,6 +5816,153 @@ void raytrace(
 
 /*****************************************************************************/
 
+int raytrace_init(
+  const ctl_t *ctl,
+  const atm_t *atm,
+  obs_t *obs,
+  los_t *los,
+  const int ir,
+  double *zmin,
+  double *zmax,
+  double *x,
+  double *ex0) {
+
+  double lat, lon, xobs[3], xvp[3], z;
+
+  /* Initialize... */
+  los->np = 0;
+  los->sft = -999;
+  obs->tpz[ir] = obs->vpz[ir];
+  obs->tplon[ir] = obs->vplon[ir];
+  obs->tplat[ir] = obs->vplat[ir];
+
+  /* Get altitude range of atmospheric data... */
+  gsl_stats_minmax(zmin, zmax, atm->z, 1, (size_t) atm->np);
+  if (ctl->nsf > 0) {
+    *zmin = MAX(atm->sfz, *zmin);
+    if (atm->sfp > 0) {
+      const int ip = locate_irr(atm->p, (atm->nlon > 1 || atm->nlat > 1
+					 ? atm->nz : atm->np), atm->sfp);
+      const double zip =
+	LIN(log(atm->p[ip]), atm->z[ip], log(atm->p[ip + 1]), atm->z[ip + 1],
+	    log(atm->sfp));
+      *zmin = MAX(zip, *zmin);
+    }
+  }
+
+  /* Check observer altitude... */
+  if (obs->obsz[ir] < *zmin)
+    ERRMSG("Observer below surface!");
+
+  /* Check view point altitude... */
+  if (obs->vpz[ir] > *zmax)
+    return 0;
+
+  /* Determine Cartesian coordinates for observer and view point... */
+  geo2cart(obs->obsz[ir], obs->obslon[ir], obs->obslat[ir], xobs);
+  geo2cart(obs->vpz[ir], obs->vplon[ir], obs->vplat[ir], xvp);
+
+  /* Determine initial tangent vector... */
+  for (int i = 0; i < 3; i++)
+    ex0[i] = xvp[i] - xobs[i];
+  const double norm = NORM(ex0);
+  for (int i = 0; i < 3; i++)
+    ex0[i] /= norm;
+
+  /* Observer within atmosphere... */
+  for (int i = 0; i < 3; i++)
+    x[i] = xobs[i];
+
+  /* Observer above atmosphere (search entry point)... */
+  if (obs->obsz[ir] > *zmax) {
+    double dmax = norm, dmin = 0;
+    while (fabs(dmin - dmax) > 0.001) {
+      const double d = (dmax + dmin) / 2;
+      for (int i = 0; i < 3; i++)
+	x[i] = xobs[i] + d * ex0[i];
+      cart2geo(x, &z, &lon, &lat);
+      if (z <= *zmax && z > *zmax - 0.001)
+	break;
+      if (z < *zmax - 0.0005)
+	dmax = d;
+      else
+	dmin = d;
+    }
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+int raytrace_point(
+  const ctl_t *ctl,
+  const atm_t *atm,
+  los_t *los,
+  const double zmin,
+  const double zmax,
+  double *x,
+  double *z,
+  double *lon,
+  double *lat,
+  double *ds,
+  double *p,
+  double *t) {
+
+  double k[NW], q[NG], xh[3];
+
+  int stop = 0;
+
+  /* Check if LOS hits the ground or has left atmosphere... */
+  if (*z < zmin || *z > zmax) {
+    stop = (*z < zmin ? 2 : 1);
+    const double frac =
+      ((*z <
+	zmin ? zmin : zmax) - los->z[los->np - 1]) / (*z - los->z[los->np -
+								    1]);
+    geo2cart(los->z[los->np - 1], los->lon[los->np - 1],
+	     los->lat[los->np - 1], xh);
+    for (int i = 0; i < 3; i++)
+      x[i] = xh[i] + frac * (x[i] - xh[i]);
+    cart2geo(x, z, lon, lat);
+    los->ds[los->np - 1] = *ds * frac;
+    *ds = 0;
+  }
+
+  /* Interpolate atmospheric data... */
+  intpol_atm(ctl, atm, *z, *lon, *lat, p, t, q, k);
+
+  /* Save data... */
+  los->lon[los->np] = *lon;
+  los->lat[los->np] = *lat;
+  los->z[los->np] = *z;
+  los->p[los->np] = *p;
+  los->t[los->np] = *t;
+  for (int ig = 0; ig < ctl->ng; ig++)
+    los->q[los->np][ig] = q[ig];
+  for (int id = 0; id < ctl->nd; id++)
+    los->k[los->np][id] = k[ctl->window[id]];
+  los->ds[los->np] = *ds;
+
+  /* Add cloud extinction... */
+  if (ctl->ncl > 0 && atm->cldz > 0) {
+    const double aux = exp(-0.5 * POW2((*z - atm->clz) / atm->cldz));
+    for (int id = 0; id < ctl->nd; id++) {
+      const int icl = ctl->clidx[id];
+      los->k[los->np][id] += aux * (atm->clk[icl] + ctl->clw[id]
+				    * (atm->clk[icl + 1] - atm->clk[icl]));
+    }
+  }
+
+  /* Increment and check number of LOS points... */
+  if ((++los->np) > NLOS)
+    ERRMSG("Too many LOS points!");
+
+  return stop;
+}
+
+/*****************************************************************************/
+
 void read_atm(
   const char *dirname,
   const char *filename,
@@ -4505,9 +6029,53 @@ void read_atm(
   if (atm->np < 1)
     ERRMSG("Could not read any data!");
 
+  /* Get grid of 3D data (stacked profiles)... */
+  atm->nlon = atm->nlat = 1;
+  atm->nz = atm->np;
+  atm->lon0 = atm->lon[0];
+  atm->lat0 = atm->lat[0];
+  atm->dlon = atm->dlat = 0;
+  int ncol = 1;
+  if (ctl->atm3d)
+    for (int ip = 1; ip < atm->np; ip++)
+      if ((atm->z[1] > atm->z[0]
+	   ? atm->z[ip] <= atm->z[ip - 1]
+	   : atm->z[ip] >= atm->z[ip - 1]))
+	ncol++;
+  if (ncol > 1) {
+
+    /* Get grid dimensions... */
+    atm->nz = atm->np / ncol;
+    atm->nlat = 1;
+    while (atm->nlat < ncol && atm->lon[atm->nlat * atm->nz] == atm->lon0)
+      atm->nlat++;
+    atm->nlon = ncol / atm->nlat;
+    if (atm->nz < 2 || atm->nz * ncol != atm->np
+	|| atm->nlon * atm->nlat != ncol)
+      ERRMSG("3D atmospheric data must be given on a regular grid!");
+    if (atm->nlon > 1)
+      atm->dlon = atm->lon[atm->nlat * atm->nz] - atm->lon0;
+    if (atm->nlat > 1)
+      atm->dlat = atm->lat[atm->nz] - atm->lat0;
+
+    /* Check grid... */
+    for (int ilon = 0; ilon < atm->nlon; ilon++)
+      for (int ilat = 0; ilat < atm->nlat; ilat++)
+	for (int iz = 0; iz < atm->nz; iz++) {
+	  const int ip = (ilon * atm->nlat + ilat) * atm->nz + iz;
+	  if (fabs(atm->z[ip] - atm->z[iz]) > 1e-6
+	      || fabs(atm->lon[ip] - (atm->lon0 + ilon * atm->dlon)) > 1e-6
+	      || fabs(atm->lat[ip] - (atm->lat0 + ilat * atm->dlat)) > 1e-6)
+	    ERRMSG("3D atmospheric data must be given on a regular grid!");
+	}
+  }
+
   /* Write info... */
   double mini, maxi;
   LOG(2, "Number of data points: %d", atm->np);
+  if (atm->nlon > 1 || atm->nlat > 1)
+    LOG(2, "3D grid: %d x %d x %d (lon x lat x z)",
+	atm->nlon, atm->nlat, atm->nz);
   gsl_stats_minmax(&mini, &maxi, atm->time, 1, (size_t) atm->np);
   LOG(2, "Time range: %.2f ... %.2f s", mini, maxi);
   gsl_stats_minmax(&mini, &maxi, atm->z, 1, (size_t) atm->np);
@@ -4600,6 +6168,42 @@ void read_ctl(
   /* Emissivity look-up tables... */
   scan_ctl(argc, argv, "TBLBASE", -1, "-", ctl->tblbase);
   ctl->tblfmt = (int) scan_ctl(argc, argv, "TBLFMT", -1, "1", NULL);
+  scan_ctl(argc, argv, "SRCCACHE", -1, "-", ctl->srccache);
+  ctl->tbllayout = (int) scan_ctl(argc, argv, "TBLLAYOUT", -1, "0", NULL);
+  if (ctl->tbllayout < 0 || ctl->tbllayout > 1)
+    ERRMSG("Set 0 <= TBLLAYOUT <= 1!");
+  scan_ctl(argc, argv, "TBLSHM", -1, "-", ctl->tblshm);
+  if (ctl->tblshm[0] != '-' && ctl->tblshm[0] != '/')
+    ERRMSG("TBLSHM must start with '/'!");
+  if (ctl->tblshm[0] != '-' && ctl->tbllayout != 0)
+    ERRMSG("TBLSHM requires TBLLAYOUT = 0!");
+  ctl->tblquant = (int) scan_ctl(argc, argv, "TBLQUANT", -1, "0", NULL);
+  if (ctl->tblquant < 0 || ctl->tblquant > 1)
+    ERRMSG("Set 0 <= TBLQUANT <= 1!");
+  ctl->tblqerr = scan_ctl(argc, argv, "TBLQERR", -1, "1e-4", NULL);
+  if (ctl->tblquant && ctl->tblqerr <= 0)
+    ERRMSG("Set TBLQERR > 0!");
+  if (ctl->tblshm[0] != '-' && ctl->tblquant != 0)
+    ERRMSG("TBLSHM requires TBLQUANT = 0!");
+  ctl->tblhuge = (int) scan_ctl(argc, argv, "TBLHUGE", -1, "0", NULL);
+  if (ctl->tblhuge < 0 || ctl->tblhuge > 2)
+    ERRMSG("Set 0 <= TBLHUGE <= 2!");
+  ctl->tblnuma = (int) scan_ctl(argc, argv, "TBLNUMA", -1, "0", NULL);
+  if (ctl->tblnuma < 0 || ctl->tblnuma > 2)
+    ERRMSG("Set 0 <= TBLNUMA <= 2!");
+  if (ctl->tblnuma == 2 && ctl->tbllayout != 1)
+    ERRMSG("TBLNUMA = 2 requires TBLLAYOUT = 1!");
+#ifndef __linux__
+  if (ctl->tblhuge != 0 || ctl->tblnuma != 0)
+    WARN("TBLHUGE and TBLNUMA are only supported on Linux!");
+#endif
+  if (ctl->tblshm[0] != '-' && (ctl->tblhuge != 0 || ctl->tblnuma != 0))
+    WARN("TBLHUGE and TBLNUMA are ignored for the shared-memory segment!");
+
+  /* Atmospheric data... */
+  ctl->atm3d = (int) scan_ctl(argc, argv, "ATM3D", -1, "0", NULL);
+  if (ctl->atm3d < 0 || ctl->atm3d > 1)
+    ERRMSG("Set 0 <= ATM3D <= 1!");
 
   /* Hydrostatic equilibrium... */
   ctl->hydz = scan_ctl(argc, argv, "HYDZ", -1, "-999", NULL);
@@ -4609,11 +6213,18 @@ void read_ctl(
   ctl->ctm_h2o = (int) scan_ctl(argc, argv, "CTM_H2O", -1, "1", NULL);
   ctl->ctm_n2 = (int) scan_ctl(argc, argv, "CTM_N2", -1, "1", NULL);
   ctl->ctm_o2 = (int) scan_ctl(argc, argv, "CTM_O2", -1, "1", NULL);
+  ctl->ctm_tbl = (int) scan_ctl(argc, argv, "CTM_TBL", -1, "0", NULL);
 
   /* Ray-tracing... */
   ctl->refrac = (int) scan_ctl(argc, argv, "REFRAC", -1, "1", NULL);
   ctl->rayds = scan_ctl(argc, argv, "RAYDS", -1, "10", NULL);
   ctl->raydz = scan_ctl(argc, argv, "RAYDZ", -1, "0.1", NULL);
+  ctl->raygeom = (int) scan_ctl(argc, argv, "RAYGEOM", -1, "0", NULL);
+  if (ctl->raygeom < 0 || ctl->raygeom > 3)
+    ERRMSG("Set 0 <= RAYGEOM <= 3!");
+  ctl->raybatch = (int) scan_ctl(argc, argv, "RAYBATCH", -1, "1", NULL);
+  if (ctl->raybatch < 1 || ctl->raybatch > NBATCH)
+    ERRMSG("Set 1 <= RAYBATCH <= NBATCH!");
 
   /* Field of view... */
   scan_ctl(argc, argv, "FOV", -1, "-", ctl->fov);
@@ -4650,6 +6261,9 @@ void read_ctl(
   scan_ctl(argc, argv, "RFMHIT", -1, "-", ctl->rfmhit);
   for (int ig = 0; ig < ctl->ng; ig++)
     scan_ctl(argc, argv, "RFMXSC", ig, "-", ctl->rfmxsc[ig]);
+
+  /* Get derived quantities... */
+  init_ctl(ctl);
 }
 
 /*****************************************************************************/
@@ -4931,17 +6545,90 @@ void read_shape(
   /* Close file... */
   fclose(in);
 
-  /* Check number of data points... */
-  if (*n < 2)
-    ERRMSG("Could not read any data!");
-
+  /* Check number of data points... */
+  if (*n < 2)
+    ERRMSG("Could not read any data!");
+
+  /* Write info... */
+  double mini, maxi;
+  LOG(2, "Number of data points: %d", *n);
+  gsl_stats_minmax(&mini, &maxi, x, 1, (size_t) *n);
+  LOG(2, "Range of x values: %.4f ... %.4f", mini, maxi);
+  gsl_stats_minmax(&mini, &maxi, y, 1, (size_t) *n);
+  LOG(2, "Range of y values: %g ... %g", mini, maxi);
+}
+
+/*****************************************************************************/
+
+int read_srcfunc(
+  const char *filename,
+  const ctl_t *ctl,
+  tbl_t *tbl,
+  const unsigned long long *hash,
+  int *done) {
+
+  FILE *in;
+
+  char magic[4];
+
+  double sr[TBLNS], tmin, tmax;
+
+  unsigned long long h;
+
+  int n, ncache = 0, ns, version;
+
+  /* Write info... */
+  LOG(1, "Read source function cache: %s", filename);
+
+  /* Open file... */
+  if (!(in = fopen(filename, "r"))) {
+    LOG(2, "Cache not found, computing source function table.");
+    return 0;
+  }
+
+  /* Read header and check file format... */
+  if (fread(magic, sizeof(char), 4, in) != 4
+      || fread(&version, sizeof(int), 1, in) != 1
+      || memcmp(magic, "JSRC", 4) != 0 || version != SRCVERSION) {
+    WARN("Source function cache has wrong format or version!");
+    fclose(in);
+    return 0;
+  }
+
+  /* Read header and check table definition... */
+  if (fread(&ns, sizeof(int), 1, in) != 1
+      || fread(&tmin, sizeof(double), 1, in) != 1
+      || fread(&tmax, sizeof(double), 1, in) != 1
+      || fread(&n, sizeof(int), 1, in) != 1
+      || ns != TBLNS || tmin != TMIN || tmax != TMAX) {
+    WARN("Source function cache does not match TBLNS, TMIN, or TMAX!");
+    fclose(in);
+    return 0;
+  }
+
+  /* Read data and match filter function hashes... */
+  for (int i = 0; i < n; i++) {
+    if (fread(&h, sizeof(unsigned long long), 1, in) != 1
+	|| fread(sr, sizeof(double), TBLNS, in) != TBLNS) {
+      WARN("Source function cache is truncated!");
+      break;
+    }
+    for (int id = 0; id < ctl->nd; id++)
+      if (!done[id] && hash[id] == h) {
+	for (int it = 0; it < TBLNS; it++)
+	  tbl->sr[it][id] = sr[it];
+	done[id] = 1;
+	ncache++;
+      }
+  }
+
+  /* Close file... */
+  fclose(in);
+
   /* Write info... */
-  double mini, maxi;
-  LOG(2, "Number of data points: %d", *n);
-  gsl_stats_minmax(&mini, &maxi, x, 1, (size_t) *n);
-  LOG(2, "Range of x values: %.4f ... %.4f", mini, maxi);
-  gsl_stats_minmax(&mini, &maxi, y, 1, (size_t) *n);
-  LOG(2, "Range of y values: %g ... %g", mini, maxi);
+  LOG(2, "Number of cached channels: %d of %d", ncache, ctl->nd);
+
+  return ncache;
 }
 
 /*****************************************************************************/
@@ -4956,6 +6643,16 @@ void read_tbl(
 
   double eps, press, temp, u;
 
+  /* Initialize... */
+  for (int ic = 0; ic < NNODE; ic++)
+    tbl->ui[ic] = tbl->epsi[ic] = NULL;
+  tbl->ncopy = 0;
+  tbl->qn = NULL;
+  tbl->qoff = NULL;
+  tbl->qlu0 = tbl->qdlu = NULL;
+  tbl->qs0 = tbl->qa = NULL;
+  tbl->qeps = NULL;
+
   /* Loop over trace gases and channels... */
   for (int id = 0; id < ctl->nd; id++)
     for (int ig = 0; ig < ctl->ng; ig++) {
@@ -5107,6 +6804,59 @@ void read_tbl(
 	    tbl->nu[id][ig][ip][0] - 1, tbl->eps[id][ig][ip][0][0],
 	    tbl->eps[id][ig][ip][0][tbl->nu[id][ig][ip][0] - 1]);
     }
+
+  /* Get active emitters of each channel and active channels of each
+     emitter (tables with less than 30 pressure levels are skipped)... */
+  for (int ig = 0; ig < ctl->ng; ig++)
+    tbl->nad[ig] = 0;
+  for (int id = 0; id < ctl->nd; id++) {
+    tbl->nag[id] = 0;
+    for (int ig = 0; ig < ctl->ng; ig++)
+      if (tbl->np[id][ig] >= 30) {
+	tbl->iag[id][tbl->nag[id]++] = ig;
+	tbl->iad[ig][tbl->nad[ig]++] = id;
+      }
+  }
+
+  /* Group channels with identical pressure and temperature grids... */
+  for (int ig = 0; ig < ctl->ng; ig++) {
+    tbl->ngrid[ig] = 0;
+    for (int iid = 0; iid < tbl->nad[ig]; iid++) {
+      const int id = tbl->iad[ig][iid];
+      int igr;
+      for (igr = 0; igr < tbl->ngrid[ig]; igr++) {
+	const int id2 = tbl->idgrid[ig][igr];
+	int same = (tbl->np[id][ig] == tbl->np[id2][ig]);
+	for (int ip = 0; same && ip < tbl->np[id][ig]; ip++)
+	  same = (tbl->p[id][ig][ip] == tbl->p[id2][ig][ip]
+		  && tbl->nt[id][ig][ip] == tbl->nt[id2][ig][ip]
+		  && memcmp(tbl->t[id][ig][ip], tbl->t[id2][ig][ip],
+			    (size_t) tbl->nt[id][ig][ip] * sizeof(double))
+		  == 0);
+	if (same)
+	  break;
+      }
+      if (igr == tbl->ngrid[ig])
+	tbl->idgrid[ig][tbl->ngrid[ig]++] = id;
+      tbl->igrid[id][ig] = igr;
+    }
+  }
+
+  /* Write info... */
+  int nact = 0;
+  for (int ig = 0; ig < ctl->ng; ig++) {
+    nact += tbl->nad[ig];
+    LOG(2, "Emitter %s is active in %d of %d channels (%d table grids).",
+	ctl->emitter[ig], tbl->nad[ig], ctl->nd, tbl->ngrid[ig]);
+  }
+  LOG(1, "Active emitter/channel pairs: %d of %d (%.1f%% skipped)", nact,
+      ctl->nd * ctl->ng,
+      (ctl->nd * ctl->ng > 0
+       ? 100. * (1. - (double) nact / (double) (ctl->nd * ctl->ng)) : 0.));
+
+  /* Initialize memory layout and quantised tables... */
+  init_tbl(ctl, tbl);
+  init_tbl_quant(ctl, tbl);
 }
 
 /*****************************************************************************/
@@ -5264,6 +7014,268 @@ void tangent_point(
 
 /*****************************************************************************/
 
+void *tbl_alloc(
+  const ctl_t *ctl,
+  const size_t size,
+  const int node) {
+
+  void *ptr = MAP_FAILED;
+
+  /* Round up to multiple of huge page size (2 MiB)... */
+  const size_t len = (size + (2UL << 20) - 1) / (2UL << 20) * (2UL << 20);
+
+#ifdef __linux__
+  /* Try explicit huge pages... */
+  if (ctl->tblhuge == 2) {
+    ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+	       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr == MAP_FAILED)
+      WARN("Explicit huge pages not available, using transparent ones!");
+  }
+#endif
+
+  /* Map normal or transparent huge pages... */
+  if (ptr == MAP_FAILED) {
+    ptr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+	       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+      ERRMSG("Out of memory!");
+#ifdef __linux__
+    if (ctl->tblhuge >= 1 && madvise(ptr, len, MADV_HUGEPAGE) != 0)
+      WARN("Transparent huge pages not available!");
+#endif
+  }
+
+#ifdef __linux__
+  /* Set NUMA policy (before first touch)... */
+  if (node >= 0 || ctl->tblnuma == 1) {
+    unsigned long mask = 0;
+    if (node >= 0)
+      mask = 1UL << node;
+    else {
+      char dirname[LEN];
+      for (int inode = 0; inode < NNODE; inode++) {
+	sprintf(dirname, "/sys/devices/system/node/node%d", inode);
+	if (access(dirname, F_OK) == 0)
+	  mask |= 1UL << inode;
+      }
+    }
+    if (mask != 0
+	&& syscall(SYS_mbind, ptr, len,
+		   node >= 0 ? MPOL_BIND : MPOL_INTERLEAVE, &mask,
+		   8 * sizeof(mask), 0) != 0)
+      WARN("Cannot set NUMA memory policy!");
+  }
+#else
+  (void) node;
+#endif
+
+  return ptr;
+}
+
+/*****************************************************************************/
+
+void tbl_free(
+  void *ptr,
+  const size_t size) {
+
+  /* Unmap memory... */
+  const size_t len = (size + (2UL << 20) - 1) / (2UL << 20) * (2UL << 20);
+  if (ptr != NULL)
+    munmap(ptr, len);
+}
+
+/*****************************************************************************/
+
+int tbl_node(
+  const tbl_t *tbl) {
+
+  /* Get NUMA node of current CPU... */
+#ifdef __linux__
+  const int cpu = sched_getcpu();
+#else
+  const int cpu = -1;
+#endif
+  const int node = (cpu >= 0 && cpu < NCPU ? tbl->cpunode[cpu] : 0);
+
+  return (node < tbl->ncopy ? node : 0);
+}
+
+/*****************************************************************************/
+
+const tbl_t *tbl_open(
+  const ctl_t *ctl) {
+
+  struct stat st;
+
+  char filename[2 * LEN];
+
+  tbl_t *tbl;
+
+  unsigned long long *hdr;
+
+  /* Header size (magic, config hash, size, ready flag; page-aligned)... */
+  const size_t nhdr = 4096;
+  const unsigned long long magic = 0x4a55524153534943ULL;
+
+  /* Private copy... */
+  if (ctl->tblshm[0] == '-') {
+    tbl = tbl_alloc(ctl, sizeof(tbl_t), -1);
+    read_tbl(ctl, tbl);
+    init_srcfunc(ctl, tbl);
+    init_continua(ctl, tbl);
+    return tbl;
+  }
+
+  /* Get hash of table configuration (dimensions, channels, emitters,
+     device, inode, size, and modification time of table and filter
+     files)... */
+  const int dims[] = { ND, NG, TBLNP, TBLNT, TBLNU, TBLNS, (int) sizeof(tbl_t),
+    ctl->nd, ctl->ng, ctl->tblfmt
+  };
+  const double tlim[] = { TMIN, TMAX };
+  unsigned long long hash = 14695981039346656037ULL;
+  hash = hash_data(dims, sizeof(dims), hash);
+  hash = hash_data(tlim, sizeof(tlim), hash);
+  hash = hash_data(ctl->nu, (size_t) ctl->nd * sizeof(double), hash);
+  hash = hash_data(ctl->tblbase, strlen(ctl->tblbase), hash);
+  for (int id = 0; id < ctl->nd; id++)
+    for (int ig = 0; ig <= ctl->ng; ig++) {
+      if (ig < ctl->ng) {
+	sprintf(filename, "%s_%.4f_%s.%s", ctl->tblbase, ctl->nu[id],
+		ctl->emitter[ig], ctl->tblfmt == 1 ? "tab" : "bin");
+	hash = hash_data(ctl->emitter[ig], strlen(ctl->emitter[ig]), hash);
+      } else
+	sprintf(filename, "%s_%.4f.filt", ctl->tblbase, ctl->nu[id]);
+      if (stat(filename, &st) == 0) {
+	const long long meta[] = { (long long) st.st_dev,
+	  (long long) st.st_ino, (long long) st.st_size,
+	  (long long) st.st_mtime,
+#ifdef __linux__
+	  (long long) st.st_mtim.tv_nsec
+#else
+	  0
+#endif
+	};
+	hash = hash_data(meta, sizeof(meta), hash);
+      }
+    }
+
+  /* Write info... */
+  LOG(1, "Open shared-memory look-up tables: %s", ctl->tblshm);
+  LOG(2, "Configuration hash: %016llx", hash);
+
+  /* Try to create segment (once more after removing an incomplete
+     segment left by a crashed process)... */
+  const size_t size = nhdr + sizeof(tbl_t);
+  for (int iopen = 0; iopen < 2; iopen++) {
+    int fd = shm_open(ctl->tblshm, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd >= 0) {
+
+      /* Lock segment until tables are ready... */
+      if (flock(fd, LOCK_EX) != 0)
+	ERRMSG("Cannot lock shared-memory segment!");
+
+      /* Map segment... */
+      if (ftruncate(fd, (off_t) size) != 0)
+	ERRMSG("Cannot resize shared-memory segment!");
+      void *ptr =
+	mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (ptr == MAP_FAILED)
+	ERRMSG("Cannot map shared-memory segment!");
+      hdr = ptr;
+      tbl = (tbl_t *) ((char *) ptr + nhdr);
+
+      /* Read tables... */
+      LOG(2, "Create segment and read tables (%g MByte)...",
+	  (double) size / 1e6);
+      read_tbl(ctl, tbl);
+      init_srcfunc(ctl, tbl);
+      init_continua(ctl, tbl);
+
+      /* Set header, mark segment as ready, and release lock... */
+      hdr[0] = magic;
+      hdr[1] = hash;
+      hdr[2] = size;
+      __atomic_store_n(&hdr[3], 1ULL, __ATOMIC_RELEASE);
+      close(fd);
+
+      return tbl;
+    }
+
+    /* Open existing segment... */
+    if (errno != EEXIST || (fd = shm_open(ctl->tblshm, O_RDONLY, 0)) < 0)
+      ERRMSG("Cannot open shared-memory segment!");
+
+    /* Wait for the lock of the creating process (retry for a while to
+       cover the short time between creating and locking the segment)... */
+    LOG(2, "Attach to segment and wait for tables...");
+    int ready = 0;
+    for (int itry = 0; itry < 50 && !ready; itry++) {
+      if (flock(fd, LOCK_SH) != 0)
+	ERRMSG("Cannot lock shared-memory segment!");
+      if (fstat(fd, &st) == 0 && (size_t) st.st_size == size) {
+	void *ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED)
+	  ERRMSG("Cannot map shared-memory segment!");
+	hdr = ptr;
+
+	/* Check header... */
+	ready = (__atomic_load_n(&hdr[3], __ATOMIC_ACQUIRE) == 1);
+	if (ready && hdr[0] == magic && hdr[1] == hash && hdr[2] == size) {
+	  close(fd);
+	  return (const tbl_t *) ((const char *) ptr + nhdr);
+	}
+	munmap(ptr, size);
+      }
+      flock(fd, LOCK_UN);
+      if (!ready)
+	usleep(100000);
+    }
+
+    /* Segment is complete but does not match the configuration... */
+    if (ready) {
+      close(fd);
+      break;
+    }
+
+    /* Remove incomplete segment (the creating process has released its
+       lock without marking the segment as ready)... */
+    struct stat st2;
+    int fd2 = -1;
+    if (flock(fd, LOCK_EX) == 0 && fstat(fd, &st) == 0
+	&& (fd2 = shm_open(ctl->tblshm, O_RDONLY, 0)) >= 0
+	&& fstat(fd2, &st2) == 0 && st2.st_ino == st.st_ino) {
+      if ((size_t) st.st_size == size) {
+	void *ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (ptr != MAP_FAILED) {
+	  hdr = ptr;
+	  ready = (__atomic_load_n(&hdr[3], __ATOMIC_ACQUIRE) == 1);
+	  munmap(ptr, size);
+	}
+      }
+      if (!ready) {
+	WARN("Removing incomplete shared-memory segment: %s", ctl->tblshm);
+	shm_unlink(ctl->tblshm);
+      }
+    }
+    if (fd2 >= 0)
+      close(fd2);
+    close(fd);
+  }
+
+  /* Fall back to private copy... */
+  WARN("Shared-memory tables are stale or do not match the configuration,"
+       " using private copy (remove /dev/shm%s?)!", ctl->tblshm);
+  tbl = tbl_alloc(ctl, sizeof(tbl_t), -1);
+  read_tbl(ctl, tbl);
+  init_srcfunc(ctl, tbl);
+  init_continua(ctl, tbl);
+  return tbl;
+}
+
+/*****************************************************************************/
+
 void time2jsec(
   const int year,
   const int mon,
@@ -5388,7 +7400,8 @@ void write_atm(
 
   /* Write data... */
   for (int ip = 0; ip < atm->np; ip++) {
-    if (ip == 0 || atm->time[ip] != atm->time[ip - 1])
+    if (ip == 0 || atm->time[ip] != atm->time[ip - 1]
+	|| ((atm->nlon > 1 || atm->nlat > 1) && ip % atm->nz == 0))
       fprintf(out, "\n");
     fprintf(out, "%.2f %g %g %g %g %g", atm->time[ip], atm->z[ip],
 	    atm->lon[ip], atm->lat[ip], atm->p[ip], atm->t[ip]);
@@ -5502,11 +7515,11 @@ void write_matrix(
 
   FILE *out;
 
-  char file[LEN], quantity[LEN];
+  char file[LEN];
 
   int *cida, *ciqa, *cipa, *cira, *rida, *riqa, *ripa, *rira;
 
-  size_t i, j, nc, nr;
+  size_t i, j;
 
   /* Check output flag... */
   if (!ctl->write_matrix)
@@ -5543,92 +7556,24 @@ void write_matrix(
   if (!(out = fopen(file, "w")))
     ERRMSG("Cannot create file!");
 
-  /* Write header (row space)... */
-  if (rowspace[0] == 'y') {
-
-    fprintf(out,
-	    "# $1 = Row: index (measurement space)\n"
-	    "# $2 = Row: channel wavenumber [cm^-1]\n"
-	    "# $3 = Row: time (seconds since 2000-01-01T00:00Z)\n"
-	    "# $4 = Row: view point altitude [km]\n"
-	    "# $5 = Row: view point longitude [deg]\n"
-	    "# $6 = Row: view point latitude [deg]\n");
-
-    /* Get number of rows... */
-    nr = obs2y(ctl, obs, NULL, rida, rira);
-
-  } else {
-
-    fprintf(out,
-	    "# $1 = Row: index (state space)\n"
-	    "# $2 = Row: name of quantity\n"
-	    "# $3 = Row: time (seconds since 2000-01-01T00:00Z)\n"
-	    "# $4 = Row: altitude [km]\n"
-	    "# $5 = Row: longitude [deg]\n" "# $6 = Row: latitude [deg]\n");
-
-    /* Get number of rows... */
-    nr = atm2x(ctl, atm, NULL, riqa, ripa);
-  }
-
-  /* Write header (column space)... */
-  if (colspace[0] == 'y') {
-
-    fprintf(out,
-	    "# $7 = Col: index (measurement space)\n"
-	    "# $8 = Col: channel wavenumber [cm^-1]\n"
-	    "# $9 = Col: time (seconds since 2000-01-01T00:00Z)\n"
-	    "# $10 = Col: view point altitude [km]\n"
-	    "# $11 = Col: view point longitude [deg]\n"
-	    "# $12 = Col: view point latitude [deg]\n");
-
-    /* Get number of columns... */
-    nc = obs2y(ctl, obs, NULL, cida, cira);
-
-  } else {
-
-    fprintf(out,
-	    "# $7 = Col: index (state space)\n"
-	    "# $8 = Col: name of quantity\n"
-	    "# $9 = Col: time (seconds since 2000-01-01T00:00Z)\n"
-	    "# $10 = Col: altitude [km]\n"
-	    "# $11 = Col: longitude [deg]\n" "# $12 = Col: latitude [deg]\n");
-
-    /* Get number of columns... */
-    nc = atm2x(ctl, atm, NULL, ciqa, cipa);
-  }
-
-  /* Write header entry... */
+  /* Write header... */
+  const size_t nr =
+    write_matrix_header(out, ctl, atm, obs, rowspace, 0, rida, riqa, ripa,
+			rira);
+  const size_t nc =
+    write_matrix_header(out, ctl, atm, obs, colspace, 1, cida, ciqa, cipa,
+			cira);
   fprintf(out, "# $13 = Matrix element\n\n");
 
   /* Write matrix data... */
   i = j = 0;
   while (i < nr && j < nc) {
 
-    /* Write info about the row... */
-    if (rowspace[0] == 'y')
-      fprintf(out, "%d %.4f %.2f %g %g %g",
-	      (int) i, ctl->nu[rida[i]],
-	      obs->time[rira[i]], obs->vpz[rira[i]],
-	      obs->vplon[rira[i]], obs->vplat[rira[i]]);
-    else {
-      idx2name(ctl, riqa[i], quantity);
-      fprintf(out, "%d %s %.2f %g %g %g", (int) i, quantity,
-	      atm->time[ripa[i]], atm->z[ripa[i]],
-	      atm->lon[ripa[i]], atm->lat[ripa[i]]);
-    }
-
-    /* Write info about the column... */
-    if (colspace[0] == 'y')
-      fprintf(out, " %d %.4f %.2f %g %g %g",
-	      (int) j, ctl->nu[cida[j]],
-	      obs->time[cira[j]], obs->vpz[cira[j]],
-	      obs->vplon[cira[j]], obs->vplat[cira[j]]);
-    else {
-      idx2name(ctl, ciqa[j], quantity);
-      fprintf(out, " %d %s %.2f %g %g %g", (int) j, quantity,
-	      atm->time[cipa[j]], atm->z[cipa[j]],
-	      atm->lon[cipa[j]], atm->lat[cipa[j]]);
-    }
+    /* Write info about the row and the column... */
+    write_matrix_index(out, ctl, atm, obs, rowspace, 0, i, rida, riqa, ripa,
+		       rira);
+    write_matrix_index(out, ctl, atm, obs, colspace, 1, j, cida, ciqa, cipa,
+		       cira);
 
     /* Write matrix entry... */
     fprintf(out, " %g\n", gsl_matrix_get(matrix, i, j));
@@ -5667,6 +7612,184 @@ void write_matrix(
 
 /*****************************************************************************/
 
+size_t write_matrix_header(
+  FILE *out,
+  const ctl_t *ctl,
+  const atm_t *atm,
+  const obs_t *obs,
+  const char *space,
+  const int col,
+  int *ida,
+  int *iqa,
+  int *ipa,
+  int *ira) {
+
+  const char *rc = (col ? "Col" : "Row");
+  const int off = (col ? 7 : 1);
+
+  /* Measurement space... */
+  if (space[0] == 'y') {
+
+    fprintf(out,
+	    "# $%d = %s: index (measurement space)\n"
+	    "# $%d = %s: channel wavenumber [cm^-1]\n"
+	    "# $%d = %s: time (seconds since 2000-01-01T00:00Z)\n"
+	    "# $%d = %s: view point altitude [km]\n"
+	    "# $%d = %s: view point longitude [deg]\n"
+	    "# $%d = %s: view point latitude [deg]\n",
+	    off, rc, off + 1, rc, off + 2, rc, off + 3, rc, off + 4, rc,
+	    off + 5, rc);
+
+    /* Get number of elements... */
+    return obs2y(ctl, obs, NULL, ida, ira);
+  }
+
+  /* State space... */
+  else {
+
+    fprintf(out,
+	    "# $%d = %s: index (state space)\n"
+	    "# $%d = %s: name of quantity\n"
+	    "# $%d = %s: time (seconds since 2000-01-01T00:00Z)\n"
+	    "# $%d = %s: altitude [km]\n"
+	    "# $%d = %s: longitude [deg]\n"
+	    "# $%d = %s: latitude [deg]\n",
+	    off, rc, off + 1, rc, off + 2, rc, off + 3, rc, off + 4, rc,
+	    off + 5, rc);
+
+    /* Get number of elements... */
+    return atm2x(ctl, atm, NULL, iqa, ipa);
+  }
+}
+
+/*****************************************************************************/
+
+void write_matrix_index(
+  FILE *out,
+  const ctl_t *ctl,
+  const atm_t *atm,
+  const obs_t *obs,
+  const char *space,
+  const int col,
+  const size_t i,
+  const int *ida,
+  const int *iqa,
+  const int *ipa,
+  const int *ira) {
+
+  char quantity[LEN];
+
+  /* Write separator for column info... */
+  if (col)
+    fprintf(out, " ");
+
+  /* Write index information... */
+  if (space[0] == 'y')
+    fprintf(out, "%d %.4f %.2f %g %g %g",
+	    (int) i, ctl->nu[ida[i]],
+	    obs->time[ira[i]], obs->vpz[ira[i]],
+	    obs->vplon[ira[i]], obs->vplat[ira[i]]);
+  else {
+    idx2name(ctl, iqa[i], quantity);
+    fprintf(out, "%d %s %.2f %g %g %g", (int) i, quantity,
+	    atm->time[ipa[i]], atm->z[ipa[i]],
+	    atm->lon[ipa[i]], atm->lat[ipa[i]]);
+  }
+}
+
+/*****************************************************************************/
+
+void write_matrix_sparse(
+  const char *dirname,
+  const char *filename,
+  const ctl_t *ctl,
+  const gsl_spmatrix *matrix,
+  const atm_t *atm,
+  const obs_t *obs,
+  const char *rowspace,
+  const char *colspace) {
+
+  FILE *out;
+
+  char file[LEN];
+
+  int *cida, *ciqa, *cipa, *cira, *rida, *riqa, *ripa, *rira;
+
+  /* Check output flag... */
+  if (!ctl->write_matrix)
+    return;
+
+  /* Check matrix format... */
+  if (matrix->sptype != GSL_SPMATRIX_CSR)
+    ERRMSG("Sparse matrix must be in compressed row format!");
+
+  /* Allocate... */
+  ALLOC(cida, int,
+	M);
+  ALLOC(ciqa, int,
+	N);
+  ALLOC(cipa, int,
+	N);
+  ALLOC(cira, int,
+	M);
+  ALLOC(rida, int,
+	M);
+  ALLOC(riqa, int,
+	N);
+  ALLOC(ripa, int,
+	N);
+  ALLOC(rira, int,
+	M);
+
+  /* Set filename... */
+  if (dirname != NULL)
+    sprintf(file, "%s/%s", dirname, filename);
+  else
+    sprintf(file, "%s", filename);
+
+  /* Write info... */
+  LOG(1, "Write sparse matrix: %s", file);
+
+  /* Create file... */
+  if (!(out = fopen(file, "w")))
+    ERRMSG("Cannot create file!");
+
+  /* Write header... */
+  const size_t nr =
+    write_matrix_header(out, ctl, atm, obs, rowspace, 0, rida, riqa, ripa,
+			rira);
+  write_matrix_header(out, ctl, atm, obs, colspace, 1, cida, ciqa, cipa,
+		      cira);
+  fprintf(out, "# $13 = Matrix element (nonzero elements only)\n\n");
+
+  /* Write nonzero elements row by row... */
+  for (size_t i = 0; i < MIN(nr, matrix->size1); i++) {
+    for (int k = matrix->p[i]; k < matrix->p[i + 1]; k++) {
+      write_matrix_index(out, ctl, atm, obs, rowspace, 0, i, rida, riqa,
+			 ripa, rira);
+      write_matrix_index(out, ctl, atm, obs, colspace, 1,
+			 (size_t) matrix->i[k], cida, ciqa, cipa, cira);
+      fprintf(out, " %g\n", matrix->data[k]);
+    }
+    fprintf(out, "\n");
+  }
+
+  /* Close file... */
+  fclose(out);
+
+  /* Free... */
+  free(cida);
+  free(ciqa);
+  free(cipa);
+  free(cira);
+  free(rida);
+  free(riqa);
+  free(ripa);
+  free(rira);
+}
+
+/*****************************************************************************/
+
 void write_obs(
   const char *dirname,
   const char *filename,
@@ -5807,6 +7930,119 @@ void write_shape(
 
 /*****************************************************************************/
 
+void write_srcfunc(
+  const char *filename,
+  const ctl_t *ctl,
+  const tbl_t *tbl,
+  const unsigned long long *hash) {
+
+  FILE *in, *out;
+
+  char tmpname[2 * LEN];
+
+  double sr[TBLNS], tmin = TMIN, tmax = TMAX;
+
+  unsigned long long h;
+
+  char magic[4];
+
+  int n, ns = TBLNS, version = SRCVERSION;
+
+  /* Write info... */
+  LOG(1, "Write source function cache: %s", filename);
+
+  /* Create temporary file (renamed below to avoid partial reads)... */
+  sprintf(tmpname, "%s.%d", filename, (int) getpid());
+  if (!(out = fopen(tmpname, "w"))) {
+    WARN("Cannot create source function cache!");
+    return;
+  }
+
+  /* Write header... */
+  FWRITE("JSRC", char,
+	 4,
+	 out);
+  FWRITE(&version, int,
+	 1,
+	 out);
+  FWRITE(&ns, int,
+	 1,
+	 out);
+  FWRITE(&tmin, double,
+	 1,
+	 out);
+  FWRITE(&tmax, double,
+	 1,
+	 out);
+  FWRITE(&ctl->nd, int,
+	 1,
+	 out);
+
+  /* Write data... */
+  for (int id = 0; id < ctl->nd; id++) {
+    for (int it = 0; it < TBLNS; it++)
+      sr[it] = tbl->sr[it][id];
+    FWRITE(&hash[id], unsigned long long,
+	   1,
+	   out);
+    FWRITE(sr, double,
+	   TBLNS,
+	   out);
+  }
+
+  /* Copy entries of other channels from existing cache... */
+  int nout = ctl->nd;
+  if ((in = fopen(filename, "r"))) {
+    if (fread(magic, sizeof(char), 4, in) == 4
+	&& fread(&version, sizeof(int), 1, in) == 1
+	&& memcmp(magic, "JSRC", 4) == 0 && version == SRCVERSION
+	&& fread(&ns, sizeof(int), 1, in) == 1
+	&& fread(&tmin, sizeof(double), 1, in) == 1
+	&& fread(&tmax, sizeof(double), 1, in) == 1
+	&& fread(&n, sizeof(int), 1, in) == 1
+	&& ns == TBLNS && tmin == TMIN && tmax == TMAX)
+      for (int i = 0; i < n; i++) {
+	if (fread(&h, sizeof(unsigned long long), 1, in) != 1
+	    || fread(sr, sizeof(double), TBLNS, in) != TBLNS)
+	  break;
+	int id;
+	for (id = 0; id < ctl->nd; id++)
+	  if (hash[id] == h)
+	    break;
+	if (id < ctl->nd)
+	  continue;
+	FWRITE(&h, unsigned long long,
+	       1,
+	       out);
+	FWRITE(sr, double,
+	       TBLNS,
+	       out);
+	nout++;
+      }
+    fclose(in);
+  }
+
+  /* Update number of entries... */
+  if (fseek(out, (long) (4 * sizeof(char) + 2 * sizeof(int)
+			 + 2 * sizeof(double)), SEEK_SET) != 0)
+    ERRMSG("Cannot rewind file!");
+  FWRITE(&nout, int,
+	 1,
+	 out);
+
+  /* Close file... */
+  fclose(out);
+  LOG(2, "Number of cached channels: %d", nout);
+
+  /* Move file in place... */
+  if (rename(tmpname, filename) != 0) {
+    WARN("Cannot rename source function cache!");
+    remove(tmpname);
+  }
+}
+
+/*****************************************************************************/
+
 void write_tbl(
   const ctl_t *ctl,
   const tbl_t *tbl) {
@@ -5848,8 +8084,8 @@ void write_tbl(
 	    for (int iu = 0; iu < tbl->nu[id][ig][ip][it]; iu++)
 	      fprintf(out, "%g %g %e %e\n",
 		      tbl->p[id][ig][ip], tbl->t[id][ig][ip][it],
-		      tbl->u[id][ig][ip][it][iu],
-		      tbl->eps[id][ig][ip][it][iu]);
+		      TBLU(tbl, 0, id, ig, ip, it)[iu],
+		      TBLEPS(tbl, 0, id, ig, ip, it)[iu]);
 	  }
       }
 
@@ -5872,10 +8108,10 @@ void write_tbl(
 	    FWRITE(&tbl->nu[id][ig][ip][it], int,
 		   1,
 		   out);
-	    FWRITE(tbl->u[id][ig][ip][it], float,
+	    FWRITE(TBLU(tbl, 0, id, ig, ip, it), float,
 		     (size_t) tbl->nu[id][ig][ip][it],
 		   out);
-	    FWRITE(tbl->eps[id][ig][ip][it], float,
+	    FWRITE(TBLEPS(tbl, 0, id, ig, ip, it), float,
 		     (size_t) tbl->nu[id][ig][ip][it],
 		   out);
 	  }
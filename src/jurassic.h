@@ -100,18 +100,37 @@
 #ifndef JURASSIC_H
 #define JURASSIC_H
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_blas.h>
+#include <gsl/gsl_eigen.h>
 #include <gsl/gsl_linalg.h>
 #include <gsl/gsl_randist.h>
 #include <gsl/gsl_rng.h>
+#include <gsl/gsl_spblas.h>
+#include <gsl/gsl_spmatrix.h>
 #include <gsl/gsl_statistics.h>
+#include <errno.h>
+#include <limits.h>
 #include <math.h>
 #include <omp.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
 
 /* ------------------------------------------------------------
    Macros...
@@ -193,10 +212,37 @@
 #define RAD2DEG(rad)				\
   ((rad) * (180.0 / M_PI))
 
+/*! Compute path integral of the radius along a straight ray
+  (ray constant b, distance s from the tangent point). */
+#define RAYINT(s, b)							\
+  (0.5 * ((s) * sqrt(POW2(s) + POW2(b))					\
+	  + ((b) > 0 ? POW2(b) * asinh((s) / (b)) : 0)))
+
 /*! Compute refractivity (return value is n - 1). */
 #define REFRAC(p, T)				\
   (7.753e-05 * (p) / (T))
 
+/*! Get table copy of calling thread (NUMA replication; resolve once
+  per ray and pass it to TBLEPS and TBLU). */
+#define TBLCOPY(tbl)				\
+  ((tbl)->ncopy > 1 ? tbl_node(tbl) : 0)
+
+/*! Get emissivity data of look-up table (for given layout and copy). */
+#define TBLEPS(tbl, ic, id, ig, ip, it)					\
+  ((tbl)->epsi[0] ? (tbl)->epsi[ic] + TBLIDX(tbl, id, ig, ip, it)	\
+   : (tbl)->eps[id][ig][ip][it])
+
+/*! Get index of channel-inner look-up table data. */
+#define TBLIDX(tbl, id, ig, ip, it)					\
+  (((((size_t) (ig) * TBLNP + (size_t) (ip)) * TBLNT + (size_t) (it))	\
+    * (size_t) (tbl)->ndi + (size_t) (id)) * TBLNU)
+
+/*! Get column density data of look-up table (for given layout and
+  copy). */
+#define TBLU(tbl, ic, id, ig, ip, it)					\
+  ((tbl)->ui[0] ? (tbl)->ui[ic] + TBLIDX(tbl, id, ig, ip, it)		\
+   : (tbl)->u[id][ig][ip][it])
+
 /*! Start or stop a timer. */
 #define TIMER(name, mode)				\
   {timer(name, __FILE__, __func__, __LINE__, mode);}
@@ -343,6 +389,21 @@
    Dimensions...
    ------------------------------------------------------------ */
 
+/*! Maximum number of rays traced in lockstep. */
+#ifndef NBATCH
+#define NBATCH 16
+#endif
+
+/*! Maximum number of NUMA nodes. */
+#ifndef NNODE
+#define NNODE 8
+#endif
+
+/*! Maximum number of CPUs. */
+#ifndef NCPU
+#define NCPU 1024
+#endif
+
 /*! Maximum number of cloud layer spectral grid points. */
 #ifndef NCL
 #define NCL 8
@@ -433,6 +494,9 @@
 #define TBLNS 1200
 #endif
 
+/*! Version of source function cache file format. */
+#define SRCVERSION 1
+
 /*! Maximum number of RFM spectral grid points. */
 #ifndef RFMNPTS
 #define RFMNPTS 10000000
@@ -535,6 +599,27 @@ typedef struct {
   /*! Surface emissivity. */
   double sfeps[NSF];
 
+  /*! Number of longitudes of 3D grid. */
+  int nlon;
+
+  /*! Number of latitudes of 3D grid. */
+  int nlat;
+
+  /*! Number of altitude levels of 3D grid. */
+  int nz;
+
+  /*! Longitude of first grid column [deg]. */
+  double lon0;
+
+  /*! Longitude spacing of 3D grid [deg]. */
+  double dlon;
+
+  /*! Latitude of first grid column [deg]. */
+  double lat0;
+
+  /*! Latitude spacing of 3D grid [deg]. */
+  double dlat;
+
 } atm_t;
 
 /*! Forward model control parameters. */
@@ -546,6 +631,12 @@ typedef struct {
   /*! Name of each emitter. */
   char emitter[NG][LEN];
 
+  /*! Emitter index of CO2 (derived, -1 if not given). */
+  int ig_co2;
+
+  /*! Emitter index of H2O (derived, -1 if not given). */
+  int ig_h2o;
+
   /*! Number of radiance channels. */
   int nd;
 
@@ -564,12 +655,24 @@ typedef struct {
   /*! Cloud layer wavenumber [cm^-1]. */
   double clnu[NCL];
 
+  /*! Cloud layer spectral grid index of each channel (derived). */
+  int clidx[ND];
+
+  /*! Cloud layer spectral interpolation weight of each channel (derived). */
+  double clw[ND];
+
   /*! Number of surface layer spectral grid points. */
   int nsf;
 
   /*! Surface layer wavenumber [cm^-1]. */
   double sfnu[NSF];
 
+  /*! Surface layer spectral grid index of each channel (derived). */
+  int sfidx[ND];
+
+  /*! Surface layer spectral interpolation weight of each channel (derived). */
+  double sfw[ND];
+
   /*! Surface treatment (0=none, 1=emissions, 2=downward, 3=solar). */
   int sftype;
 
@@ -582,6 +685,31 @@ typedef struct {
   /*! Look-up table file format (1=ASCII, 2=binary). */
   int tblfmt;
 
+  /*! Source function table cache file (- to disable). */
+  char srccache[LEN];
+
+  /*! Look-up table memory layout (0=channel-outer, 1=channel-inner). */
+  int tbllayout;
+
+  /*! Shared-memory segment of look-up tables (- to disable). */
+  char tblshm[LEN];
+
+  /*! Quantise emissivity tables (0=no, 1=16-bit on log(u) grid). */
+  int tblquant;
+
+  /*! Maximum error of quantised emissivity tables. */
+  double tblqerr;
+
+  /*! Look-up table huge pages (0=no, 1=transparent, 2=explicit). */
+  int tblhuge;
+
+  /*! Look-up table NUMA placement (0=first touch, 1=interleave, 2=replicate). */
+  int tblnuma;
+
+  /*! Atmospheric data given as stacked profiles on a regular 3D grid
+    (0=no, 1=yes). */
+  int atm3d;
+
   /*! Reference height for hydrostatic pressure profile (-999 to skip) [km]. */
   double hydz;
 
@@ -597,6 +725,9 @@ typedef struct {
   /*! Compute O2 continuum (0=no, 1=yes). */
   int ctm_o2;
 
+  /*! Use tabulated temperature dependence of continua (0=no, 1=yes). */
+  int ctm_tbl;
+
   /*! Take into account refractivity (0=no, 1=yes). */
   int refrac;
 
@@ -606,6 +737,13 @@ typedef struct {
   /*! Vertical step length for raytracing [km]. */
   double raydz;
 
+  /*! Ray geometry (0=3D raytracing, 1=spherical shells,
+     2=plane-parallel nadir, 3=nadir with spherical correction). */
+  int raygeom;
+
+  /*! Number of rays traced in lockstep (1=scalar ray-tracer). */
+  int raybatch;
+
   /*! Field-of-view data file. */
   char fov[LEN];
 
@@ -728,6 +866,9 @@ typedef struct {
   /*! Segment source function [W/(m^2 sr cm^-1)]. */
   double src[NLOS][ND];
 
+  /*! Absorption coefficient of extinction and continua [km^-1]. */
+  double beta[NLOS][ND];
+
 } los_t;
 
 /*! Observation geometry and radiance data. */
@@ -780,6 +921,27 @@ typedef struct {
   /*! Number of pressure levels. */
   int np[ND][NG];
 
+  /*! Number of active emitters of each channel. */
+  int nag[ND];
+
+  /*! Indices of active emitters of each channel. */
+  int iag[ND][NG];
+
+  /*! Number of active channels of each emitter. */
+  int nad[NG];
+
+  /*! Indices of active channels of each emitter. */
+  int iad[NG][ND];
+
+  /*! Number of distinct pressure and temperature grids of each emitter. */
+  int ngrid[NG];
+
+  /*! Reference channel of each pressure and temperature grid. */
+  int idgrid[NG][ND];
+
+  /*! Pressure and temperature grid index of each channel and emitter. */
+  int igrid[ND][NG];
+
   /*! Number of temperatures. */
   int nt[ND][NG][TBLNP];
 
@@ -792,18 +954,77 @@ typedef struct {
   /*! Temperature [K]. */
   double t[ND][NG][TBLNP][TBLNT];
 
-  /*! Column density [molecules/cm^2]. */
+  /*! Column density [molecules/cm^2] (converted in place for
+    TBLLAYOUT = 1). */
   float u[ND][NG][TBLNP][TBLNT][TBLNU];
 
-  /*! Emissivity. */
+  /*! Emissivity (converted in place for TBLLAYOUT = 1). */
   float eps[ND][NG][TBLNP][TBLNT][TBLNU];
 
+  /*! Number of channels of channel-inner layout. */
+  int ndi;
+
+  /*! Size of channel-inner layout tables [byte]. */
+  size_t nbytes;
+
+  /*! Number of copies of channel-inner layout tables. */
+  int ncopy;
+
+  /*! NUMA node of each CPU. */
+  int cpunode[NCPU];
+
+  /*! Quantised emissivity: number of log(u) grid points (0=not used)
+    [id][ig][ip][it] (or NULL). */
+  int (*qn)[NG][TBLNP][TBLNT];
+
+  /*! Quantised emissivity: offset of curve in data array (or NULL). */
+  int (*qoff)[NG][TBLNP][TBLNT];
+
+  /*! Quantised emissivity: log(u) of first grid point (or NULL). */
+  double (*qlu0)[NG][TBLNP][TBLNT];
+
+  /*! Quantised emissivity: inverse log(u) grid spacing (or NULL). */
+  double (*qdlu)[NG][TBLNP][TBLNT];
+
+  /*! Quantised emissivity: slope below first column density (or NULL). */
+  float (*qs0)[NG][TBLNP][TBLNT];
+
+  /*! Quantised emissivity: decay rate above last column density (or
+    NULL). */
+  float (*qa)[NG][TBLNP][TBLNT];
+
+  /*! Quantised emissivity data, eps * 65535 (or NULL). */
+  unsigned short *qeps;
+
+  /*! Column density, channel-inner layout [ig][ip][it][id][iu] (or NULL,
+    first copy points to u). */
+  float *ui[NNODE];
+
+  /*! Emissivity, channel-inner layout [ig][ip][it][id][iu] (or NULL,
+    first copy points to eps). */
+  float *epsi[NNODE];
+
   /*! Source function temperature [K]. */
   double st[TBLNS];
 
   /*! Source function radiance [W/(m^2 sr cm^-1)]. */
   double sr[TBLNS][ND];
 
+  /*! CO2 continuum for unit pressure and column density. */
+  double ctmco2[TBLNS][ND];
+
+  /*! H2O self continuum for unit pressure and column density. */
+  double ctmh2os[TBLNS][ND];
+
+  /*! H2O foreign continuum for unit pressure and column density. */
+  double ctmh2of[TBLNS][ND];
+
+  /*! N2 continuum for unit pressure [km^-1]. */
+  double ctmn2[TBLNS][ND];
+
+  /*! O2 continuum for unit pressure [km^-1]. */
+  double ctmo2[TBLNS][ND];
+
 } tbl_t;
 
 /* ------------------------------------------------------------
@@ -892,24 +1113,40 @@ void formod(
   atm_t * atm,
   obs_t * obs);
 
-/*! Compute absorption coefficient of continua. */
+/*! Compute absorption coefficient of extinction and continua along a LOS. */
 void formod_continua(
   const ctl_t * ctl,
-  const los_t * los,
-  const int ip,
-  double *beta);
+  const tbl_t * tbl,
+  los_t * los);
 
 /*! Apply field of view convolution. */
 void formod_fov(
   const ctl_t * ctl,
   obs_t * obs);
 
-/*! Compute radiative transfer for a pencil beam. */
+/*! Compute radiative transfer along a line of sight. */
+void formod_los(
+  const ctl_t * ctl,
+  const tbl_t * tbl,
+  los_t * los,
+  obs_t * obs,
+  const int ir);
+
+/*! Compute radiative transfer for all rays in plane-parallel nadir geometry. */
+void formod_nadir(
+  const ctl_t * ctl,
+  const tbl_t * tbl,
+  const atm_t * atm,
+  obs_t * obs);
+
+/*! Compute radiative transfer for a batch of pencil beams. */
 void formod_pencil(
   const ctl_t * ctl,
+  const tbl_t * tbl,
   const atm_t * atm,
   obs_t * obs,
-  const int ir);
+  const int ir0,
+  const int nb);
 
 /*! Apply RFM for radiative transfer calculations. */
 void formod_rfm(
@@ -917,6 +1154,13 @@ void formod_rfm(
   const atm_t * atm,
   obs_t * obs);
 
+/*! Compute radiative transfer for all rays in spherical shells. */
+void formod_shells(
+  const ctl_t * ctl,
+  const tbl_t * tbl,
+  const atm_t * atm,
+  obs_t * obs);
+
 /*! Compute Planck source function. */
 void formod_srcfunc(
   const ctl_t * ctl,
@@ -931,6 +1175,16 @@ void geo2cart(
   const double lat,
   double *x);
 
+/*! Update 64-bit FNV-1a hash with given data. */
+unsigned long long hash_data(
+  const void *data,
+  const size_t n,
+  unsigned long long hash);
+
+/*! Compute 64-bit FNV-1a hash of file content. */
+unsigned long long hash_file(
+  const char *filename);
+
 /*! Set hydrostatic equilibrium. */
 void hydrostatic(
   const ctl_t * ctl,
@@ -942,16 +1196,46 @@ void idx2name(
   const int idx,
   char *quantity);
 
+/*! Tabulate temperature dependence of continua. */
+void init_continua(
+  const ctl_t * ctl,
+  tbl_t * tbl);
+
+/*! Compute derived control parameters (emitter indices, spectral weights). */
+void init_ctl(
+  ctl_t * ctl);
+
+/*! Get atmospheric data, continua, and source function of spherical shells. */
+void init_shells(
+  const ctl_t * ctl,
+  const tbl_t * tbl,
+  const atm_t * atm,
+  los_t * shl,
+  double *zmin,
+  double *dz);
+
 /*! Initialize source function table. */
 void init_srcfunc(
   const ctl_t * ctl,
   tbl_t * tbl);
 
+/*! Initialize memory layout of look-up tables. */
+void init_tbl(
+  const ctl_t * ctl,
+  tbl_t * tbl);
+
+/*! Initialize quantised emissivity tables. */
+void init_tbl_quant(
+  const ctl_t * ctl,
+  tbl_t * tbl);
+
 /*! Interpolate atmospheric data. */
 void intpol_atm(
   const ctl_t * ctl,
   const atm_t * atm,
   const double z,
+  const double lon,
+  const double lat,
   double *p,
   double *t,
   double *q,
@@ -961,6 +1245,7 @@ void intpol_atm(
 void intpol_tbl_cga(
   const ctl_t * ctl,
   const tbl_t * tbl,
+  const int ic,
   const los_t * los,
   const int ip,
   double tau_path[ND][NG],
@@ -970,6 +1255,7 @@ void intpol_tbl_cga(
 void intpol_tbl_ega(
   const ctl_t * ctl,
   const tbl_t * tbl,
+  const int ic,
   const los_t * los,
   const int ip,
   double tau_path[ND][NG],
@@ -978,15 +1264,45 @@ void intpol_tbl_ega(
 /*! Interpolate emissivity from look-up tables. */
 double intpol_tbl_eps(
   const tbl_t * tbl,
+  const int ic,
   const int ig,
   const int id,
   const int ip,
   const int it,
   const double u);
 
+/*! Get table indices and weights for pressure and temperature. */
+void intpol_tbl_grid(
+  const tbl_t * tbl,
+  const int ig,
+  const int id,
+  const double p,
+  const double t,
+  const int logp,
+  int *ipr,
+  int *it0,
+  int *it1,
+  double *wp,
+  double *wt0,
+  double *wt1);
+
+/*! Get transmittance from look-up tables (plane-parallel nadir geometry). */
+void intpol_tbl_nadir(
+  const ctl_t * ctl,
+  const tbl_t * tbl,
+  const int ic,
+  const los_t * los,
+  const int ip,
+  const int nr,
+  double u[NR][NG],
+  double cgu[NR][NG],
+  double tau_path[NR][ND][NG],
+  double tau_seg[NR][ND]);
+
 /*! Interpolate column density from look-up tables. */
 double intpol_tbl_u(
   const tbl_t * tbl,
+  const int ic,
   const int ig,
   const int id,
   const int ip,
@@ -1011,6 +1327,30 @@ void kernel(
   obs_t * obs,
   gsl_matrix * k);
 
+/*! Compute single column of Jacobians by perturbing state vector element. */
+void kernel_column(
+  ctl_t * ctl,
+  atm_t * atm,
+  obs_t * obs,
+  const gsl_vector * x0,
+  const gsl_vector * yy0,
+  const int iq,
+  const size_t j,
+  gsl_vector * kj);
+
+/*! Get perturbation size of state vector element for Jacobians. */
+double kernel_pert(
+  const ctl_t * ctl,
+  const int iq,
+  const double x);
+
+/*! Compute Jacobians in sparse (CSR) format with drop tolerance. */
+gsl_spmatrix *kernel_sparse(
+  ctl_t * ctl,
+  atm_t * atm,
+  obs_t * obs,
+  const double droptol);
+
 /*! Find array index for irregular grid. */
 int locate_irr(
   const double *xx,
@@ -1045,6 +1385,51 @@ void raytrace(
   los_t * los,
   const int ir);
 
+/*! Do ray-tracing for a batch of rays in lockstep. */
+void raytrace_batch(
+  const ctl_t * ctl,
+  const atm_t * atm,
+  obs_t * obs,
+  los_t * los,
+  const int ir0,
+  const int nb);
+
+/*! Set surface data, segment lengths, and Curtis-Godson means of a LOS. */
+void raytrace_finalize(
+  const ctl_t * ctl,
+  const atm_t * atm,
+  obs_t * obs,
+  los_t * los,
+  const int ir,
+  const int stop);
+
+/*! Initialize LOS and find starting point and direction of a ray. */
+int raytrace_init(
+  const ctl_t * ctl,
+  const atm_t * atm,
+  obs_t * obs,
+  los_t * los,
+  const int ir,
+  double *zmin,
+  double *zmax,
+  double *x,
+  double *ex0);
+
+/*! Add point to LOS and check whether the ray has left the atmosphere. */
+int raytrace_point(
+  const ctl_t * ctl,
+  const atm_t * atm,
+  los_t * los,
+  const double zmin,
+  const double zmax,
+  double *x,
+  double *z,
+  double *lon,
+  double *lat,
+  double *ds,
+  double *p,
+  double *t);
+
 /*! Read atmospheric data. */
 void read_atm(
   const char *dirname,
@@ -1093,6 +1478,14 @@ void read_shape(
   double *y,
   int *n);
 
+/*! Read cached source function table data. */
+int read_srcfunc(
+  const char *filename,
+  const ctl_t * ctl,
+  tbl_t * tbl,
+  const unsigned long long *hash,
+  int *done);
+
 /*! Read look-up table data. */
 void read_tbl(
   const ctl_t * ctl,
@@ -1120,6 +1513,25 @@ void tangent_point(
   double *tplon,
   double *tplat);
 
+/*! Allocate memory for look-up tables (huge pages, NUMA placement). */
+void *tbl_alloc(
+  const ctl_t * ctl,
+  const size_t size,
+  const int node);
+
+/*! Free memory of look-up tables. */
+void tbl_free(
+  void *ptr,
+  const size_t size);
+
+/*! Get NUMA node of calling thread. */
+int tbl_node(
+  const tbl_t * tbl);
+
+/*! Get look-up tables (private copy or shared-memory segment). */
+const tbl_t *tbl_open(
+  const ctl_t * ctl);
+
 /*! Convert date to seconds. */
 void time2jsec(
   const int year,
@@ -1139,6 +1551,31 @@ void timer(
   int line,
   int mode);
 
+/*! Convert Cartesian coordinates to geolocation for a batch of points. */
+void vec_cart2geo(
+  const int n,
+  const double *x0,
+  const double *x1,
+  const double *x2,
+  double *z,
+  double *lon,
+  double *lat);
+
+/*! Integrate Planck function weighted by filter function. */
+double vec_planck(
+  const int n,
+  const double *ff,
+  const double *c1,
+  const double *c2,
+  const double t);
+
+/*! Get transmittance exp(-beta * ds) for a vector of extinctions. */
+void vec_tau(
+  const int n,
+  const double *beta,
+  const double ds,
+  double *tau);
+
 /*! Write atmospheric data. */
 void write_atm(
   const char *dirname,
@@ -1164,6 +1601,44 @@ void write_matrix(
   const char *colspace,
   const char *sort);
 
+/*! Write header of matrix file for row or column space. */
+size_t write_matrix_header(
+  FILE * out,
+  const ctl_t * ctl,
+  const atm_t * atm,
+  const obs_t * obs,
+  const char *space,
+  const int col,
+  int *ida,
+  int *iqa,
+  int *ipa,
+  int *ira);
+
+/*! Write row or column index information of matrix element. */
+void write_matrix_index(
+  FILE * out,
+  const ctl_t * ctl,
+  const atm_t * atm,
+  const obs_t * obs,
+  const char *space,
+  const int col,
+  const size_t i,
+  const int *ida,
+  const int *iqa,
+  const int *ipa,
+  const int *ira);
+
+/*! Write sparse matrix (CSR format, nonzero elements only). */
+void write_matrix_sparse(
+  const char *dirname,
+  const char *filename,
+  const ctl_t * ctl,
+  const gsl_spmatrix * matrix,
+  const atm_t * atm,
+  const obs_t * obs,
+  const char *rowspace,
+  const char *colspace);
+
 /*! Write observation data. */
 void write_obs(
   const char *dirname,
@@ -1178,6 +1653,13 @@ void write_shape(
   const double *y,
   const int n);
 
+/*! Write source function table cache. */
+void write_srcfunc(
+  const char *filename,
+  const ctl_t * ctl,
+  const tbl_t * tbl,
+  const unsigned long long *hash);
+
 /*! Write look-up table data. */
 void write_tbl(
   const ctl_t * ctl,
@@ -30,9 +30,10 @@ int main(
 
   static atm_t atm, atm2;
   static ctl_t ctl;
-  static los_t los;
   static obs_t obs;
 
+  los_t *losb;
+
   FILE *out;
 
   char filename[LEN], losbase[LEN];
@@ -55,6 +56,9 @@ int main(
   /* Read atmospheric data... */
   read_atm(NULL, argv[3], &ctl, &atm);
 
+  /* Allocate... */
+  ALLOC(losb, los_t, ctl.raybatch);
+
   /* Write info... */
   LOG(1, "Write raytrace data: raytrace.tab");
 
@@ -80,53 +84,67 @@ int main(
 	    13 + ig, ctl.emitter[ig]);
   fprintf(out, "\n");
 
-  /* Loop over rays... */
-  for (int ir = 0; ir < obs.nr; ir++) {
+  /* Loop over batches of rays... */
+  for (int ir0 = 0; ir0 < obs.nr; ir0 += ctl.raybatch) {
 
     /* Raytracing... */
-    raytrace(&ctl, &atm, &obs, &los, ir);
-
-    /* Copy data... */
-    atm2.np = los.np;
-    for (int ip = 0; ip < los.np; ip++) {
-      atm2.time[ip] = obs.time[ir];
-      atm2.z[ip] = los.z[ip];
-      atm2.lon[ip] = los.lon[ip];
-      atm2.lat[ip] = los.lat[ip];
-      atm2.p[ip] = los.p[ip];
-      atm2.t[ip] = los.t[ip];
+    const int nb = MIN(ctl.raybatch, obs.nr - ir0);
+    if (nb == 1)
+      raytrace(&ctl, &atm, &obs, losb, ir0);
+    else
+      raytrace_batch(&ctl, &atm, &obs, losb, ir0, nb);
+
+    /* Loop over rays... */
+    for (int ir = ir0; ir < ir0 + nb; ir++) {
+      const los_t *los = &losb[ir - ir0];
+
+      /* Copy data... */
+      if (los->np > NP)
+	ERRMSG("Too many LOS points for output!");
+      atm2.np = los->np;
+      for (int ip = 0; ip < los->np; ip++) {
+	atm2.time[ip] = obs.time[ir];
+	atm2.z[ip] = los->z[ip];
+	atm2.lon[ip] = los->lon[ip];
+	atm2.lat[ip] = los->lat[ip];
+	atm2.p[ip] = los->p[ip];
+	atm2.t[ip] = los->t[ip];
+	for (int ig = 0; ig < ctl.ng; ig++)
+	  atm2.q[ig][ip] = los->q[ip][ig];
+	for (int iw = 0; iw < ctl.nw; iw++)
+	  atm2.k[iw][ip] = NAN;
+      }
+
+      /* Save data... */
+      sprintf(filename, "los.%d", ir);
+      write_atm(NULL, filename, &ctl, &atm2);
+
+      /* Get column densities... */
+      double s = 0;
       for (int ig = 0; ig < ctl.ng; ig++)
-	atm2.q[ig][ip] = los.q[ip][ig];
-      for (int iw = 0; iw < ctl.nw; iw++)
-	atm2.k[iw][ip] = NAN;
-    }
-
-    /* Save data... */
-    sprintf(filename, "los.%d", ir);
-    write_atm(NULL, filename, &ctl, &atm2);
-
-    /* Get column densities... */
-    double s = 0;
-    for (int ig = 0; ig < ctl.ng; ig++)
-      u[ig] = 0;
-    for (int ip = 0; ip < los.np; ip++) {
-      s += los.ds[ip];
+	u[ig] = 0;
+      for (int ip = 0; ip < los->np; ip++) {
+	s += los->ds[ip];
+	for (int ig = 0; ig < ctl.ng; ig++)
+	  u[ig] += los->u[ip][ig];
+      }
+
+      /* Write summary data... */
+      fprintf(out, "%.2f %g %g %g %g %g %g %g %g %g %d %g",
+	      obs.time[ir], obs.obsz[ir], obs.obslon[ir], obs.obslat[ir],
+	      obs.vpz[ir], obs.vplon[ir], obs.vplat[ir],
+	      obs.tpz[ir], obs.tplon[ir], obs.tplat[ir], ir, s);
       for (int ig = 0; ig < ctl.ng; ig++)
-	u[ig] += los.u[ip][ig];
+	fprintf(out, " %g", u[ig]);
+      fprintf(out, "\n");
     }
-
-    /* Write summary data... */
-    fprintf(out, "%.2f %g %g %g %g %g %g %g %g %g %d %g",
-	    obs.time[ir], obs.obsz[ir], obs.obslon[ir], obs.obslat[ir],
-	    obs.vpz[ir], obs.vplon[ir], obs.vplat[ir],
-	    obs.tpz[ir], obs.tplon[ir], obs.tplat[ir], ir, s);
-    for (int ig = 0; ig < ctl.ng; ig++)
-      fprintf(out, " %g", u[ig]);
-    fprintf(out, "\n");
   }
 
   /* Close file... */
   fclose(out);
 
+  /* Free... */
+  free(losb);
+
   return EXIT_SUCCESS;
 }
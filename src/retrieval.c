@@ -34,9 +34,49 @@ typedef struct {
   /*! Working directory. */
   char dir[LEN];
 
+  /*! Number of profiles retrieved concurrently. */
+  int nprof;
+
+  /*! Number of threads per retrieval (0=automatic). */
+  int nthrd;
+
+  /*! Skip directories with completed or incomplete (started but not
+     finished) retrievals (0=no, 1=yes). */
+  int resume;
+
+  /*! Number of profiles per batch (stacked retrieval). */
+  int batch;
+
+  /*! Warm start from previous profile (0=no, 1=first guess,
+     2=first guess and kernel matrix). */
+  int warm;
+
+  /*! Maximum horizontal distance for warm start [km]. */
+  double warm_dmax;
+
   /*! Re-computation of kernel matrix (number of iterations). */
   int kernel_recomp;
 
+  /*! Broyden updates of kernel matrix between re-computations
+     (0=no, 1=yes). */
+  int kernel_broyden;
+
+  /*! Sparse storage of kernel matrix (0=no, 1=yes). */
+  int kernel_sparse;
+
+  /*! Drop tolerance of sparse kernel matrix (relative to column maximum). */
+  double kernel_droptol;
+
+  /*! Linear solver of Levenberg-Marquardt steps (0=Cholesky,
+     1=generalized eigen-decomposition, 2=conjugate gradients). */
+  int lm_solver;
+
+  /*! Relative residual for convergence of conjugate gradients. */
+  double lm_cg_tol;
+
+  /*! Number of Levenberg-Marquardt trial steps evaluated in parallel. */
+  int lm_nspec;
+
   /*! Maximum number of iterations. */
   int conv_itmax;
 
@@ -111,6 +151,69 @@ typedef struct {
 
 } ret_t;
 
+/*! Retrieval state of a single profile (batch retrieval). */
+typedef struct {
+
+  /*! Retrieval control parameters and working directory. */
+  ret_t *ret;
+
+  /*! A priori and current atmospheric data. */
+  atm_t *atm_apr, *atm_i;
+
+  /*! Measured and simulated observation data. */
+  obs_t *obs_meas, *obs_i;
+
+  /*! Cost function file. */
+  FILE *out;
+
+  /*! Quantity and profile indices of state vector elements. */
+  int *iqa, *ipa;
+
+  /*! Sizes of measurement and state vector. */
+  size_t m, n;
+
+  /*! Current and previous value of cost function. */
+  double chisq, chisq_old;
+
+  /*! Levenberg-Marquardt parameter. */
+  double lmpar;
+
+  /*! Profile still iterating (0=no, 1=yes). */
+  int active;
+
+  /*! Trial step accepted in current iteration (0=no, 1=yes). */
+  int accept;
+
+  /*! Work matrix, K^T S_eps^-1 K, kernel matrix, and S_a^-1. */
+  gsl_matrix *a, *cov, *k_i, *s_a_inv;
+
+  /*! Vectors of the Levenberg-Marquardt iteration (see
+     optimal_estimation). */
+  gsl_vector *b, *dx, *dy, *sig_eps_inv, *sig_formod, *sig_noise, *x_a,
+    *x_i, *x_step, *y_aux, *y_i, *y_m;
+
+} prof_t;
+
+/*! Warm-start data of the previous retrieval. */
+typedef struct {
+
+  /*! Working directory of previous retrieval. */
+  char dir[LEN];
+
+  /*! Data are valid (previous retrieval converged) (0=no, 1=yes). */
+  int valid;
+
+  /*! Converged atmospheric state. */
+  atm_t *atm;
+
+  /*! Kernel matrix at the end of the previous retrieval. */
+  gsl_matrix *k;
+
+  /*! Final Levenberg-Marquardt parameter. */
+  double lmpar;
+
+} warm_t;
+
 /* ------------------------------------------------------------
    Functions...
    ------------------------------------------------------------ */
@@ -134,6 +237,30 @@ void analyze_avk_quantity(
   double *cont,
   double *res);
 
+/*! Carry out error analysis and write retrieval errors, gain matrix,
+  and averaging kernels. */
+void analyze_errors(
+  ret_t * ret,
+  ctl_t * ctl,
+  atm_t * atm_i,
+  obs_t * obs_i,
+  int *iqa,
+  int *ipa,
+  gsl_matrix * k_i,
+  gsl_spmatrix * k_sp,
+  gsl_matrix * s_a_inv,
+  gsl_vector * sig_eps_inv,
+  gsl_vector * sig_noise,
+  gsl_vector * sig_formod);
+
+/*! Get vertical and horizontal correlation lengths of a quantity. */
+void corr_len(
+  ret_t * ret,
+  ctl_t * ctl,
+  int iq,
+  double *cz,
+  double *ch);
+
 /*! Compute cost function. */
 double cost_function(
   gsl_vector * dx,
@@ -141,17 +268,93 @@ double cost_function(
   gsl_matrix * s_a_inv,
   gsl_vector * sig_eps_inv);
 
+/*! Get Cholesky factor of inverse a priori covariance (sparse, with
+  the row profiles of the block inverse, compressed row format). */
+gsl_spmatrix *cov_apr_cholesky(
+  gsl_matrix * s_a_inv,
+  int *iqa);
+
+/*! Invert a priori covariance block by block for each quantity,
+  using tridiagonal inverses of exponential correlations along a
+  profile. */
+void cov_apr_invert(
+  ret_t * ret,
+  ctl_t * ctl,
+  atm_t * atm,
+  int *iqa,
+  int *ipa,
+  gsl_matrix * s_a);
+
+/*! Check whether a block of the a priori covariance is a single
+  profile with strictly monotonic altitudes (tridiagonal inverse). */
+int cov_apr_tri(
+  atm_t * atm,
+  int *ipa,
+  size_t i0,
+  size_t i1);
+
+/*! Set trial state, run forward model, and compute cost function. */
+double eval_state(
+  ctl_t * ctl,
+  atm_t * atm_apr,
+  obs_t * obs_meas,
+  gsl_vector * x_a,
+  gsl_vector * y_m,
+  gsl_matrix * s_a_inv,
+  gsl_vector * sig_eps_inv,
+  gsl_vector * x_i,
+  atm_t * atm_i,
+  obs_t * obs_i,
+  gsl_vector * y_i,
+  gsl_vector * dx,
+  gsl_vector * dy);
+
 /*! Invert symmetric matrix. */
 void matrix_invert(
   gsl_matrix * a);
 
-/*! Compute matrix product A^TBA or ABA^T for diagonal matrix B. */
+/*! Compute matrix product A^TBA or ABA^T for diagonal matrix B
+  (symmetric rank-k update, blocked). */
 void matrix_product(
   gsl_matrix * a,
   gsl_vector * b,
   int transpose,
   gsl_matrix * c);
 
+/*! Compute matrix product A^TBA for diagonal matrix B and sparse
+  matrix A (CSR format). */
+void matrix_product_sparse(
+  gsl_spmatrix * a,
+  gsl_vector * b,
+  gsl_matrix * c);
+
+/*! Multiply vector with a priori covariance, x = S_a x (given as
+  sparse Cholesky factor of S_a^-1). */
+void mult_cov_apr(
+  gsl_spmatrix * s_a_chol,
+  gsl_vector * x);
+
+/*! Multiply vector with inverse a priori covariance, y = alpha S_a^-1 x
+  + beta y (given as sparse Cholesky factor of S_a^-1). */
+void mult_cov_apr_inv(
+  gsl_spmatrix * s_a_chol,
+  double alpha,
+  gsl_vector * x,
+  double beta,
+  gsl_vector * y,
+  gsl_vector * aux);
+
+/*! Multiply vector with kernel matrix, y = alpha op(K) x + beta y
+  (dense or sparse kernel matrix). */
+void mult_kernel(
+  gsl_matrix * k,
+  gsl_spmatrix * k_sp,
+  CBLAS_TRANSPOSE_t trans,
+  double alpha,
+  gsl_vector * x,
+  double beta,
+  gsl_vector * y);
+
 /*! Carry out optimal estimation retrieval. */
 void optimal_estimation(
   ret_t * ret,
@@ -159,7 +362,15 @@ void optimal_estimation(
   obs_t * obs_meas,
   obs_t * obs_i,
   atm_t * atm_apr,
-  atm_t * atm_i);
+  atm_t * atm_i,
+  warm_t * warm);
+
+/*! Carry out optimal estimation retrieval for a batch of profiles
+  (stacked Jacobians, block-diagonal solves in parallel). */
+void optimal_estimation_batch(
+  ctl_t * ctl,
+  prof_t * prof,
+  int np);
 
 /*! Read retrieval control parameters. */
 void read_ret(
@@ -168,6 +379,11 @@ void read_ret(
   ctl_t * ctl,
   ret_t * ret);
 
+/*! Read retrieval status of working directory (-1=none, 0=started,
+  1=done). */
+int read_status(
+  ret_t * ret);
+
 /*! Set a priori covariance. */
 void set_cov_apr(
   ret_t * ret,
@@ -186,6 +402,33 @@ void set_cov_meas(
   gsl_vector * sig_formod,
   gsl_vector * sig_eps_inv);
 
+/*! Solve Levenberg-Marquardt equations by means of preconditioned
+  conjugate gradients (matrix-free, work space of size 4 x n and m). */
+int solve_cg(
+  ret_t * ret,
+  gsl_matrix * k,
+  gsl_spmatrix * k_sp,
+  gsl_vector * sig_eps_inv,
+  gsl_spmatrix * s_a_chol,
+  double lmpar,
+  gsl_vector * b,
+  gsl_vector * x,
+  gsl_matrix * work,
+  gsl_vector * y_aux);
+
+/*! Check if warm-start data can be used for a priori state
+  (same state vector layout and nearby location). */
+int warm_check(
+  ret_t * ret,
+  warm_t * warm,
+  atm_t * atm_apr);
+
+/*! Write retrieval status of working directory. */
+void write_status(
+  ret_t * ret,
+  int status,
+  double dt);
+
 /*! Write retrieval error to file. */
 void write_stddev(
   const char *quantity,
@@ -202,13 +445,15 @@ int main(
   int argc,
   char *argv[]) {
 
-  static atm_t atm_i, atm_apr;
   static ctl_t ctl;
-  static obs_t obs_i, obs_meas;
   static ret_t ret;
 
   FILE *dirlist;
 
+  char **dirs = NULL;
+
+  int ndir = 0, ndone = 0, nskip = 0, nfail = 0;
+
   /* Check arguments... */
   if (argc < 3)
     ERRMSG("Give parameters: <ctl> <dirlist>");
@@ -224,27 +469,153 @@ int main(
   if (!(dirlist = fopen(argv[2], "r")))
     ERRMSG("Cannot open directory list!");
 
-  /* Loop over directories... */
+  /* Read directory list... */
   while (fscanf(dirlist, "%4999s", ret.dir) != EOF) {
+    if ((dirs = realloc(dirs, (size_t) (ndir + 1) * sizeof(char *))) == NULL
+	|| (dirs[ndir] = strdup(ret.dir)) == NULL)
+      ERRMSG("Out of memory!");
+    ndir++;
+  }
+  fclose(dirlist);
 
-    /* Write info... */
-    LOG(1, "\nRetrieve in directory %s...\n", ret.dir);
+  /* Set number of threads per retrieval... */
+  const int nthrd = (ret.nthrd > 0 ? ret.nthrd
+		     : MAX(omp_get_max_threads() / ret.nprof, 1));
+
+  /* Set nesting depth of parallel regions (concurrent profiles,
+     speculative trial steps or profiles of a batch, forward model)... */
+  omp_set_max_active_levels((ret.nprof > 1)
+			    + (ret.lm_nspec > 1 || ret.batch > 1) + 1);
+
+  /* Write info... */
+  LOG(1, "Directories: %d | concurrent profiles: %d"
+      " | threads per retrieval: %d | profiles per batch: %d", ndir,
+      ret.nprof, nthrd, ret.batch);
+
+  /* Allocate warm-start data (one per worker)... */
+  warm_t *warm;
+  ALLOC(warm, warm_t, ret.nprof);
+  for (int iw = 0; iw < ret.nprof; iw++) {
+    warm[iw].valid = 0;
+    warm[iw].k = NULL;
+    ALLOC(warm[iw].atm, atm_t, 1);
+  }
+
+  /* Set schedule (contiguous chunks of directories per worker for
+     warm starts, otherwise work queue)... */
+  if (ret.warm)
+    omp_set_schedule(omp_sched_static, 0);
+  else
+    omp_set_schedule(omp_sched_dynamic, 1);
+
+  /* Loop over batches of directories... */
+  const double t0 = omp_get_wtime();
+  const int nbatch = (ndir + ret.batch - 1) / ret.batch;
+#pragma omp parallel for schedule(runtime) num_threads(ret.nprof) default(shared) reduction(+:ndone,nskip,nfail)
+  for (int ibatch = 0; ibatch < nbatch; ibatch++) {
+
+    prof_t *prof;
+
+    int np = 0;
+
+    /* Allocate... */
+    ALLOC(prof, prof_t, ret.batch);
+
+    /* Set number of threads... */
+    omp_set_num_threads(nthrd);
+    const double t1 = omp_get_wtime();
+
+    /* Loop over directories of batch... */
+    for (int idir = ibatch * ret.batch;
+	 idir < MIN((ibatch + 1) * ret.batch, ndir); idir++) {
+
+      prof_t *p = &prof[np];
+
+      /* Allocate... */
+      ALLOC(p->atm_apr, atm_t, 1);
+      ALLOC(p->atm_i, atm_t, 1);
+      ALLOC(p->obs_i, obs_t, 1);
+      ALLOC(p->obs_meas, obs_t, 1);
+      ALLOC(p->ret, ret_t, 1);
+
+      /* Set working directory... */
+      *p->ret = ret;
+      strcpy(p->ret->dir, dirs[idir]);
+
+      /* Skip completed retrievals and retrievals that were started
+         but did not finish in a previous run (e.g. because of an
+         error)... */
+      const int status = (p->ret->resume ? read_status(p->ret) : -1);
+      if (status >= 0) {
+	if (status == 1) {
+	  LOG(1, "\nSkip directory %s (done)...", p->ret->dir);
+	  nskip++;
+	} else {
+	  WARN("Skip directory %s (started but not finished,"
+	       " remove ret_status.tab to retry)!", p->ret->dir);
+	  nfail++;
+	}
+	free(p->atm_apr);
+	free(p->atm_i);
+	free(p->obs_i);
+	free(p->obs_meas);
+	free(p->ret);
+	continue;
+      }
 
-    /* Read atmospheric data... */
-    read_atm(ret.dir, "atm_apr.tab", &ctl, &atm_apr);
+      /* Write info... */
+      LOG(1, "\nRetrieve in directory %s...\n", p->ret->dir);
+      write_status(p->ret, 0, 0);
 
-    /* Read observation data... */
-    read_obs(ret.dir, "obs_meas.tab", &ctl, &obs_meas);
+      /* Read atmospheric data... */
+      read_atm(p->ret->dir, "atm_apr.tab", &ctl, p->atm_apr);
+
+      /* Read observation data... */
+      read_obs(p->ret->dir, "obs_meas.tab", &ctl, p->obs_meas);
+      np++;
+    }
 
     /* Run retrieval... */
-    optimal_estimation(&ret, &ctl, &obs_meas, &obs_i, &atm_apr, &atm_i);
+    if (ret.batch == 1 && np == 1)
+      optimal_estimation(prof[0].ret, &ctl, prof[0].obs_meas, prof[0].obs_i,
+			 prof[0].atm_apr, prof[0].atm_i,
+			 &warm[omp_get_thread_num()]);
+    else if (np > 0)
+      optimal_estimation_batch(&ctl, prof, np);
+
+    /* Mark retrievals as done... */
+    for (int ip = 0; ip < np; ip++) {
+      write_status(prof[ip].ret, 1, omp_get_wtime() - t1);
+      ndone++;
+
+      /* Free... */
+      free(prof[ip].atm_apr);
+      free(prof[ip].atm_i);
+      free(prof[ip].obs_i);
+      free(prof[ip].obs_meas);
+      free(prof[ip].ret);
+    }
 
-    /* Measure CPU-time... */
-    TIMER("total", 2);
+    /* Free... */
+    free(prof);
   }
 
   /* Write info... */
+  const double dt = omp_get_wtime() - t0;
   LOG(1, "\nRetrieval done...");
+  LOG(1, "Retrieved profiles: %d (skipped: %d done / %d not finished)"
+      " | %.1f s | %.1f profiles/hour", ndone, nskip, nfail, dt,
+      dt > 0 ? 3600. * ndone / dt : 0.);
+
+  /* Free... */
+  for (int idir = 0; idir < ndir; idir++)
+    free(dirs[idir]);
+  free(dirs);
+  for (int iw = 0; iw < ret.nprof; iw++) {
+    free(warm[iw].atm);
+    gsl_matrix_free(warm[iw].k);
+  }
+  free(warm);
 
   /* Measure CPU-time... */
   TIMER("total", 3);
@@ -262,7 +633,7 @@ void analyze_avk(
   int *ipa,
   gsl_matrix *avk) {
 
-  static atm_t atm_cont, atm_res;
+  atm_t *atm_cont, *atm_res;
 
   size_t i, n0[NQ], n1[NQ];
 
@@ -280,35 +651,43 @@ void analyze_avk(
     }
   }
 
+  /* Allocate... */
+  ALLOC(atm_cont, atm_t, 1);
+  ALLOC(atm_res, atm_t, 1);
+
   /* Initialize... */
-  copy_atm(ctl, &atm_cont, atm, 1);
-  copy_atm(ctl, &atm_res, atm, 1);
+  copy_atm(ctl, atm_cont, atm, 1);
+  copy_atm(ctl, atm_res, atm, 1);
 
   /* Analyze quantities... */
-  analyze_avk_quantity(avk, IDXP, ipa, n0, n1, atm_cont.p, atm_res.p);
-  analyze_avk_quantity(avk, IDXT, ipa, n0, n1, atm_cont.t, atm_res.t);
+  analyze_avk_quantity(avk, IDXP, ipa, n0, n1, atm_cont->p, atm_res->p);
+  analyze_avk_quantity(avk, IDXT, ipa, n0, n1, atm_cont->t, atm_res->t);
   for (int ig = 0; ig < ctl->ng; ig++)
     analyze_avk_quantity(avk, IDXQ(ig), ipa, n0, n1,
-			 atm_cont.q[ig], atm_res.q[ig]);
+			 atm_cont->q[ig], atm_res->q[ig]);
   for (int iw = 0; iw < ctl->nw; iw++)
     analyze_avk_quantity(avk, IDXK(iw), ipa, n0, n1,
-			 atm_cont.k[iw], atm_res.k[iw]);
-  analyze_avk_quantity(avk, IDXCLZ, ipa, n0, n1, &atm_cont.clz, &atm_res.clz);
-  analyze_avk_quantity(avk, IDXCLDZ, ipa, n0, n1, &atm_cont.cldz,
-		       &atm_res.cldz);
+			 atm_cont->k[iw], atm_res->k[iw]);
+  analyze_avk_quantity(avk, IDXCLZ, ipa, n0, n1, &atm_cont->clz, &atm_res->clz);
+  analyze_avk_quantity(avk, IDXCLDZ, ipa, n0, n1, &atm_cont->cldz,
+		       &atm_res->cldz);
   for (int icl = 0; icl < ctl->ncl; icl++)
     analyze_avk_quantity(avk, IDXCLK(icl), ipa, n0, n1,
-			 &atm_cont.clk[icl], &atm_res.clk[icl]);
-  analyze_avk_quantity(avk, IDXSFZ, ipa, n0, n1, &atm_cont.sfz, &atm_res.sfz);
-  analyze_avk_quantity(avk, IDXSFP, ipa, n0, n1, &atm_cont.sfp, &atm_res.sfp);
-  analyze_avk_quantity(avk, IDXSFT, ipa, n0, n1, &atm_cont.sft, &atm_res.sft);
+			 &atm_cont->clk[icl], &atm_res->clk[icl]);
+  analyze_avk_quantity(avk, IDXSFZ, ipa, n0, n1, &atm_cont->sfz, &atm_res->sfz);
+  analyze_avk_quantity(avk, IDXSFP, ipa, n0, n1, &atm_cont->sfp, &atm_res->sfp);
+  analyze_avk_quantity(avk, IDXSFT, ipa, n0, n1, &atm_cont->sft, &atm_res->sft);
   for (int isf = 0; isf < ctl->nsf; isf++)
     analyze_avk_quantity(avk, IDXSFEPS(isf), ipa, n0, n1,
-			 &atm_cont.sfeps[isf], &atm_res.sfeps[isf]);
+			 &atm_cont->sfeps[isf], &atm_res->sfeps[isf]);
 
   /* Write results to disk... */
-  write_atm(ret->dir, "atm_cont.tab", ctl, &atm_cont);
-  write_atm(ret->dir, "atm_res.tab", ctl, &atm_res);
+  write_atm(ret->dir, "atm_cont.tab", ctl, atm_cont);
+  write_atm(ret->dir, "atm_res.tab", ctl, atm_res);
+
+  /* Free... */
+  free(atm_cont);
+  free(atm_res);
 }
 
 /*****************************************************************************/
@@ -337,6 +716,153 @@ void analyze_avk_quantity(
 
 /*****************************************************************************/
 
+void analyze_errors(
+  ret_t *ret,
+  ctl_t *ctl,
+  atm_t *atm_i,
+  obs_t *obs_i,
+  int *iqa,
+  int *ipa,
+  gsl_matrix *k_i,
+  gsl_spmatrix *k_sp,
+  gsl_matrix *s_a_inv,
+  gsl_vector *sig_eps_inv,
+  gsl_vector *sig_noise,
+  gsl_vector *sig_formod) {
+
+  /* Get sizes... */
+  const size_t m = sig_eps_inv->size;
+  const size_t n = s_a_inv->size1;
+
+  /* Allocate... */
+  gsl_matrix *a = gsl_matrix_alloc(n, n);
+  gsl_matrix *auxnm =
+    (!ret->kernel_sparse ? gsl_matrix_alloc(n, m) : NULL);
+  gsl_matrix *corr = gsl_matrix_alloc(n, n);
+  gsl_matrix *cov = gsl_matrix_alloc(n, n);
+  gsl_matrix *gain = gsl_matrix_alloc(n, m);
+
+  /* Compute inverse retrieval covariance...
+     cov^{-1} = S_a^{-1} + K_i^T * S_eps^{-1} * K_i */
+  if (ret->kernel_sparse)
+    matrix_product_sparse(k_sp, sig_eps_inv, cov);
+  else
+    matrix_product(k_i, sig_eps_inv, 1, cov);
+  gsl_matrix_add(cov, s_a_inv);
+
+  /* Compute retrieval covariance... */
+  matrix_invert(cov);
+  write_matrix(ret->dir, "matrix_cov_ret.tab", ctl, cov,
+	       atm_i, obs_i, "x", "x", "r");
+  write_stddev("total", ret, ctl, atm_i, cov);
+
+  /* Compute correlation matrix... */
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      gsl_matrix_set(corr, i, j, gsl_matrix_get(cov, i, j)
+		     / sqrt(gsl_matrix_get(cov, i, i))
+		     / sqrt(gsl_matrix_get(cov, j, j)));
+  write_matrix(ret->dir, "matrix_corr.tab", ctl, corr,
+	       atm_i, obs_i, "x", "x", "r");
+
+  /* Compute gain matrix...
+     G = cov * K^T * S_eps^{-1} */
+  if (ret->kernel_sparse) {
+    gsl_matrix_set_zero(gain);
+    for (size_t i = 0; i < m; i++) {
+      const double w = POW2(gsl_vector_get(sig_eps_inv, i));
+      for (int k = k_sp->p[i]; k < k_sp->p[i + 1]; k++) {
+	gsl_vector_view cj = gsl_matrix_column(cov, (size_t) k_sp->i[k]);
+	gsl_vector_view gi = gsl_matrix_column(gain, i);
+	gsl_blas_daxpy(k_sp->data[k] * w, &cj.vector, &gi.vector);
+      }
+    }
+  } else {
+    for (size_t i = 0; i < n; i++)
+      for (size_t j = 0; j < m; j++)
+	gsl_matrix_set(auxnm, i, j, gsl_matrix_get(k_i, j, i)
+		       * POW2(gsl_vector_get(sig_eps_inv, j)));
+    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0, cov, auxnm, 0.0,
+		   gain);
+  }
+  write_matrix(ret->dir, "matrix_gain.tab", ctl, gain,
+	       atm_i, obs_i, "x", "y", "c");
+
+  /* Compute retrieval error due to noise... */
+  matrix_product(gain, sig_noise, 2, a);
+  write_stddev("noise", ret, ctl, atm_i, a);
+
+  /* Compute retrieval error  due to forward model errors... */
+  matrix_product(gain, sig_formod, 2, a);
+  write_stddev("formod", ret, ctl, atm_i, a);
+
+  /* Compute averaging kernel matrix
+     A = G * K ... */
+  if (ret->kernel_sparse) {
+    gsl_matrix_set_zero(a);
+    for (size_t i = 0; i < m; i++)
+      for (int k = k_sp->p[i]; k < k_sp->p[i + 1]; k++) {
+	gsl_vector_view gi = gsl_matrix_column(gain, i);
+	gsl_vector_view aj = gsl_matrix_column(a, (size_t) k_sp->i[k]);
+	gsl_blas_daxpy(k_sp->data[k], &gi.vector, &aj.vector);
+      }
+  } else
+    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0, gain, k_i, 0.0, a);
+  write_matrix(ret->dir, "matrix_avk.tab", ctl, a,
+	       atm_i, obs_i, "x", "x", "r");
+
+  /* Analyze averaging kernel matrix... */
+  analyze_avk(ret, ctl, atm_i, iqa, ipa, a);
+
+  /* Free... */
+  gsl_matrix_free(a);
+  gsl_matrix_free(auxnm);
+  gsl_matrix_free(corr);
+  gsl_matrix_free(cov);
+  gsl_matrix_free(gain);
+}
+
+/*****************************************************************************/
+
+void corr_len(
+  ret_t *ret,
+  ctl_t *ctl,
+  int iq,
+  double *cz,
+  double *ch) {
+
+  /* Initialize... */
+  *cz = *ch = 0;
+
+  /* Set correlation lengths for pressure... */
+  if (iq == IDXP) {
+    *cz = ret->err_press_cz;
+    *ch = ret->err_press_ch;
+  }
+
+  /* Set correlation lengths for temperature... */
+  if (iq == IDXT) {
+    *cz = ret->err_temp_cz;
+    *ch = ret->err_temp_ch;
+  }
+
+  /* Set correlation lengths for volume mixing ratios... */
+  for (int ig = 0; ig < ctl->ng; ig++)
+    if (iq == IDXQ(ig)) {
+      *cz = ret->err_q_cz[ig];
+      *ch = ret->err_q_ch[ig];
+    }
+
+  /* Set correlation lengths for extinction... */
+  for (int iw = 0; iw < ctl->nw; iw++)
+    if (iq == IDXK(iw)) {
+      *cz = ret->err_k_cz[iw];
+      *ch = ret->err_k_ch[iw];
+    }
+}
+
+/*****************************************************************************/
+
 double cost_function(
   gsl_vector *dx,
   gsl_vector *dy,
@@ -364,8 +890,235 @@ double cost_function(
   gsl_vector_free(x_aux);
   gsl_vector_free(y_aux);
 
-  /* Return cost function value... */
-  return (chisq_m + chisq_a) / (double) m;
+  /* Return cost function value... */
+  return (chisq_m + chisq_a) / (double) m;
+}
+
+/*****************************************************************************/
+
+gsl_spmatrix *cov_apr_cholesky(
+  gsl_matrix *s_a_inv,
+  int *iqa) {
+
+  double *l;
+
+  size_t *j0, *off, i1, nz = 0;
+
+  /* Get size... */
+  const size_t n = s_a_inv->size1;
+
+  /* Allocate... */
+  ALLOC(j0, size_t,
+	n);
+  ALLOC(off, size_t,
+	n);
+
+  /* Get first non-zero column and offset of each row within blocks
+     of the same quantity (the factor has the same row profiles)... */
+  for (size_t i0 = 0; i0 < n; i0 = i1) {
+    i1 = i0 + 1;
+    while (i1 < n && iqa[i1] == iqa[i0])
+      i1++;
+    for (size_t i = i0; i < i1; i++) {
+      j0[i] = i0;
+      while (j0[i] < i && gsl_matrix_get(s_a_inv, i, j0[i]) == 0)
+	j0[i]++;
+      off[i] = nz;
+      nz += i - j0[i] + 1;
+    }
+  }
+
+  /* Cholesky decomposition within row profiles... */
+  ALLOC(l, double,
+	nz);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = j0[i]; j <= i; j++) {
+      double sum = gsl_matrix_get(s_a_inv, i, j);
+      for (size_t k = MAX(j0[i], j0[j]); k < j; k++)
+	sum -= l[off[i] + k - j0[i]] * l[off[j] + k - j0[j]];
+      if (j < i)
+	l[off[i] + j - j0[i]] = sum / l[off[j] + j - j0[j]];
+      else if (sum > 0)
+	l[off[i] + i - j0[i]] = sqrt(sum);
+      else
+	ERRMSG("Inverse a priori covariance is not positive definite!");
+    }
+
+  /* Copy factor to sparse matrix... */
+  gsl_spmatrix *coo = gsl_spmatrix_alloc_nzmax(n, n, nz, GSL_SPMATRIX_COO);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = j0[i]; j <= i; j++)
+      gsl_spmatrix_set(coo, i, j, l[off[i] + j - j0[i]]);
+  gsl_spmatrix *s_a_chol = gsl_spmatrix_compress(coo, GSL_SPMATRIX_CSR);
+
+  /* Write info... */
+  LOG(2, "A priori covariance: sparse Cholesky factor with %d non-zeros",
+      (int) nz);
+
+  /* Free... */
+  gsl_spmatrix_free(coo);
+  free(j0);
+  free(l);
+  free(off);
+
+  return s_a_chol;
+}
+
+/*****************************************************************************/
+
+void cov_apr_invert(
+  ret_t *ret,
+  ctl_t *ctl,
+  atm_t *atm,
+  int *iqa,
+  int *ipa,
+  gsl_matrix *s_a) {
+
+  double cz, ch;
+
+  size_t i1, ntri = 0;
+
+  /* Get size... */
+  const size_t n = s_a->size1;
+
+  /* Loop over blocks of state vector elements of the same quantity
+     (there are no correlations between different quantities)... */
+  for (size_t i0 = 0; i0 < n; i0 = i1) {
+
+    /* Find end of block... */
+    i1 = i0 + 1;
+    while (i1 < n && iqa[i1] == iqa[i0])
+      i1++;
+    const size_t nb = i1 - i0;
+
+    /* Get correlation lengths... */
+    corr_len(ret, ctl, iqa[i0], &cz, &ch);
+
+    /* Uncorrelated elements (diagonal block)... */
+    if (cz <= 0 || ch <= 0 || nb == 1) {
+      for (size_t i = i0; i < i1; i++)
+	gsl_matrix_set(s_a, i, i, 1 / gsl_matrix_get(s_a, i, i));
+      continue;
+    }
+
+    /* Tridiagonal inverse of exponential (first-order Markov)
+       correlations, r_k = exp(-|z_k+1 - z_k| / cz) ... */
+    if (cov_apr_tri(atm, ipa, i0, i1)) {
+      double *r, *sig;
+      ALLOC(r, double,
+	    nb);
+      ALLOC(sig, double,
+	    nb);
+      for (size_t k = 0; k < nb; k++) {
+	sig[k] = sqrt(gsl_matrix_get(s_a, i0 + k, i0 + k));
+	r[k] = (k < nb - 1 ?
+		exp(-fabs(atm->z[ipa[i0 + k + 1]] - atm->z[ipa[i0 + k]])
+		    / cz) : 0);
+      }
+      for (size_t i = i0; i < i1; i++)
+	for (size_t j = i0; j < i1; j++)
+	  gsl_matrix_set(s_a, i, j, 0);
+      for (size_t k = 0; k < nb; k++) {
+	double d = 1 / (1 - POW2(r[k]));
+	if (k > 0)
+	  d += 1 / (1 - POW2(r[k - 1])) - 1;
+	gsl_matrix_set(s_a, i0 + k, i0 + k, d / POW2(sig[k]));
+	if (k < nb - 1) {
+	  const double e = -r[k] / (1 - POW2(r[k])) / (sig[k] * sig[k + 1]);
+	  gsl_matrix_set(s_a, i0 + k, i0 + k + 1, e);
+	  gsl_matrix_set(s_a, i0 + k + 1, i0 + k, e);
+	}
+      }
+      free(r);
+      free(sig);
+      ntri += nb;
+    }
+
+    /* Inversion of dense block by means of Cholesky decomposition... */
+    else {
+      gsl_matrix_view blk = gsl_matrix_submatrix(s_a, i0, i0, nb, nb);
+      gsl_linalg_cholesky_decomp(&blk.matrix);
+      gsl_linalg_cholesky_invert(&blk.matrix);
+    }
+  }
+
+  /* Write info... */
+  LOG(2, "A priori covariance: tridiagonal inverse for %d of %d elements",
+      (int) ntri, (int) n);
+}
+
+/*****************************************************************************/
+
+int cov_apr_tri(
+  atm_t *atm,
+  int *ipa,
+  size_t i0,
+  size_t i1) {
+
+  /* Check for single profile with strictly monotonic altitudes... */
+  for (size_t i = i0 + 1; i < i1; i++)
+    if (atm->lon[ipa[i]] != atm->lon[ipa[i0]]
+	|| atm->lat[ipa[i]] != atm->lat[ipa[i0]]
+	|| (atm->z[ipa[i]] - atm->z[ipa[i - 1]])
+	* (atm->z[ipa[i0 + 1]] - atm->z[ipa[i0]]) <= 0)
+      return 0;
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+double eval_state(
+  ctl_t *ctl,
+  atm_t *atm_apr,
+  obs_t *obs_meas,
+  gsl_vector *x_a,
+  gsl_vector *y_m,
+  gsl_matrix *s_a_inv,
+  gsl_vector *sig_eps_inv,
+  gsl_vector *x_i,
+  atm_t *atm_i,
+  obs_t *obs_i,
+  gsl_vector *y_i,
+  gsl_vector *dx,
+  gsl_vector *dy) {
+
+  /* Update atmospheric state... */
+  copy_atm(ctl, atm_i, atm_apr, 0);
+  copy_obs(ctl, obs_i, obs_meas, 0);
+  x2atm(ctl, x_i, atm_i);
+
+  /* Check atmospheric state... */
+  for (int ip = 0; ip < atm_i->np; ip++) {
+    atm_i->p[ip] = MIN(MAX(atm_i->p[ip], 5e-7), 5e4);
+    atm_i->t[ip] = MIN(MAX(atm_i->t[ip], 100), 400);
+    for (int ig = 0; ig < ctl->ng; ig++)
+      atm_i->q[ig][ip] = MIN(MAX(atm_i->q[ig][ip], 0), 1);
+    for (int iw = 0; iw < ctl->nw; iw++)
+      atm_i->k[iw][ip] = MAX(atm_i->k[iw][ip], 0);
+  }
+  atm_i->clz = MAX(atm_i->clz, 0);
+  atm_i->cldz = MAX(atm_i->cldz, 0.1);
+  for (int icl = 0; icl < ctl->ncl; icl++)
+    atm_i->clk[icl] = MAX(atm_i->clk[icl], 0);
+  atm_i->sfz = MAX(atm_i->sfz, 0);
+  atm_i->sfp = MAX(atm_i->sfp, 0);
+  atm_i->sft = MIN(MAX(atm_i->sft, 100), 400);
+  for (int isf = 0; isf < ctl->nsf; isf++)
+    atm_i->sfeps[isf] = MIN(MAX(atm_i->sfeps[isf], 0), 1);
+
+  /* Forward calculation... */
+  formod(ctl, atm_i, obs_i);
+  obs2y(ctl, obs_i, y_i, NULL, NULL);
+
+  /* Determine dx = x_i - x_a and dy = y - F(x_i) ... */
+  gsl_vector_memcpy(dx, x_i);
+  gsl_vector_sub(dx, x_a);
+  gsl_vector_memcpy(dy, y_m);
+  gsl_vector_sub(dy, y_i);
+
+  /* Compute cost function... */
+  return cost_function(dx, dy, s_a_inv, sig_eps_inv);
 }
 
 /*****************************************************************************/
@@ -410,37 +1163,178 @@ void matrix_product(
   const size_t m = a->size1;
   const size_t n = a->size2;
 
-  /* Allocate... */
-  gsl_matrix *aux = gsl_matrix_alloc(m, n);
-
   /* Compute A^T B A... */
   if (transpose == 1) {
 
-    /* Compute B^1/2 A... */
-    for (size_t i = 0; i < m; i++)
-      for (size_t j = 0; j < n; j++)
-	gsl_matrix_set(aux, i, j,
-		       gsl_vector_get(b, i) * gsl_matrix_get(a, i, j));
+    /* Set block size (about 256 kB per block)... */
+    const size_t mb = MIN(MAX(32768 / n, 1), m);
+
+    /* Allocate... */
+    gsl_matrix *aux = gsl_matrix_alloc(mb, n);
+
+    /* Loop over blocks of rows... */
+    for (size_t i0 = 0; i0 < m; i0 += mb) {
+      const size_t nr = MIN(mb, m - i0);
+
+      /* Compute B^1/2 A for current block... */
+      for (size_t i = 0; i < nr; i++) {
+	const double bi = gsl_vector_get(b, i0 + i);
+	const double *ai = gsl_matrix_ptr(a, i0 + i, 0);
+	double *auxi = gsl_matrix_ptr(aux, i, 0);
+	for (size_t j = 0; j < n; j++)
+	  auxi[j] = bi * ai[j];
+      }
 
-    /* Compute A^T B A = (B^1/2 A)^T (B^1/2 A)... */
-    gsl_blas_dgemm(CblasTrans, CblasNoTrans, 1.0, aux, aux, 0.0, c);
+      /* Add (B^1/2 A)^T (B^1/2 A) to lower triangle of C... */
+      gsl_matrix_view blk = gsl_matrix_submatrix(aux, 0, 0, nr, n);
+      gsl_blas_dsyrk(CblasLower, CblasTrans, 1.0, &blk.matrix,
+		     i0 == 0 ? 0.0 : 1.0, c);
+    }
+
+    /* Free... */
+    gsl_matrix_free(aux);
   }
 
   /* Compute A B A^T... */
   else if (transpose == 2) {
 
-    /* Compute A B^1/2... */
-    for (size_t i = 0; i < m; i++)
-      for (size_t j = 0; j < n; j++)
-	gsl_matrix_set(aux, i, j,
-		       gsl_matrix_get(a, i, j) * gsl_vector_get(b, j));
+    /* Set block size (about 256 kB per block)... */
+    const size_t nb = MIN(MAX(32768 / m, 1), n);
 
-    /* Compute A B A^T = (A B^1/2) (A B^1/2)^T... */
-    gsl_blas_dgemm(CblasNoTrans, CblasTrans, 1.0, aux, aux, 0.0, c);
+    /* Allocate... */
+    gsl_matrix *aux = gsl_matrix_alloc(m, nb);
+
+    /* Loop over blocks of columns... */
+    for (size_t j0 = 0; j0 < n; j0 += nb) {
+      const size_t nc = MIN(nb, n - j0);
+
+      /* Compute A B^1/2 for current block... */
+      for (size_t i = 0; i < m; i++) {
+	const double *ai = gsl_matrix_ptr(a, i, j0);
+	double *auxi = gsl_matrix_ptr(aux, i, 0);
+	for (size_t j = 0; j < nc; j++)
+	  auxi[j] = ai[j] * gsl_vector_get(b, j0 + j);
+      }
+
+      /* Add (A B^1/2) (A B^1/2)^T to lower triangle of C... */
+      gsl_matrix_view blk = gsl_matrix_submatrix(aux, 0, 0, m, nc);
+      gsl_blas_dsyrk(CblasLower, CblasNoTrans, 1.0, &blk.matrix,
+		     j0 == 0 ? 0.0 : 1.0, c);
+    }
+
+    /* Free... */
+    gsl_matrix_free(aux);
   }
 
-  /* Free... */
-  gsl_matrix_free(aux);
+  /* Copy lower triangle to upper triangle... */
+  const size_t nc = c->size1;
+  for (size_t i = 0; i < nc; i++)
+    for (size_t j = i + 1; j < nc; j++)
+      gsl_matrix_set(c, i, j, gsl_matrix_get(c, j, i));
+}
+
+/*****************************************************************************/
+
+void matrix_product_sparse(
+  gsl_spmatrix *a,
+  gsl_vector *b,
+  gsl_matrix *c) {
+
+  /* Check matrix format... */
+  if (a->sptype != GSL_SPMATRIX_CSR)
+    ERRMSG("Sparse matrix must be in compressed row format!");
+
+  /* Initialize... */
+  gsl_matrix_set_zero(c);
+
+  /* Add outer products of scaled rows to lower triangle of C... */
+  for (size_t i = 0; i < a->size1; i++) {
+    const double bi = POW2(gsl_vector_get(b, i));
+    for (int k1 = a->p[i]; k1 < a->p[i + 1]; k1++) {
+      const size_t j1 = (size_t) a->i[k1];
+      const double aux = bi * a->data[k1];
+      double *cj1 = gsl_matrix_ptr(c, j1, 0);
+      for (int k2 = a->p[i]; k2 < a->p[i + 1]; k2++)
+	if ((size_t) a->i[k2] <= j1)
+	  cj1[a->i[k2]] += aux * a->data[k2];
+    }
+  }
+
+  /* Copy lower triangle to upper triangle... */
+  const size_t nc = c->size1;
+  for (size_t i = 0; i < nc; i++)
+    for (size_t j = i + 1; j < nc; j++)
+      gsl_matrix_set(c, i, j, gsl_matrix_get(c, j, i));
+}
+
+/*****************************************************************************/
+
+void mult_cov_apr(
+  gsl_spmatrix *s_a_chol,
+  gsl_vector *x) {
+
+  /* Get size... */
+  const size_t n = x->size;
+
+  /* Solve L y = x (forward substitution)... */
+  for (size_t i = 0; i < n; i++) {
+    double d = 1, sum = gsl_vector_get(x, i);
+    for (int k = s_a_chol->p[i]; k < s_a_chol->p[i + 1]; k++)
+      if ((size_t) s_a_chol->i[k] == i)
+	d = s_a_chol->data[k];
+      else
+	sum -= s_a_chol->data[k] * gsl_vector_get(x, (size_t) s_a_chol->i[k]);
+    gsl_vector_set(x, i, sum / d);
+  }
+
+  /* Solve L^T x = y (backward substitution)... */
+  for (size_t i = n; i-- > 0;) {
+    double d = 1;
+    for (int k = s_a_chol->p[i]; k < s_a_chol->p[i + 1]; k++)
+      if ((size_t) s_a_chol->i[k] == i)
+	d = s_a_chol->data[k];
+    const double xi = gsl_vector_get(x, i) / d;
+    gsl_vector_set(x, i, xi);
+    for (int k = s_a_chol->p[i]; k < s_a_chol->p[i + 1]; k++)
+      if ((size_t) s_a_chol->i[k] != i)
+	*gsl_vector_ptr(x, (size_t) s_a_chol->i[k]) -=
+	  s_a_chol->data[k] * xi;
+  }
+}
+
+/*****************************************************************************/
+
+void mult_cov_apr_inv(
+  gsl_spmatrix *s_a_chol,
+  double alpha,
+  gsl_vector *x,
+  double beta,
+  gsl_vector *y,
+  gsl_vector *aux) {
+
+  /* Compute y = alpha L L^T x + beta y ... */
+  gsl_spblas_dgemv(CblasTrans, 1.0, s_a_chol, x, 0.0, aux);
+  gsl_spblas_dgemv(CblasNoTrans, alpha, s_a_chol, aux, beta, y);
+}
+
+/*****************************************************************************/
+
+void mult_kernel(
+  gsl_matrix *k,
+  gsl_spmatrix *k_sp,
+  CBLAS_TRANSPOSE_t trans,
+  double alpha,
+  gsl_vector *x,
+  double beta,
+  gsl_vector *y) {
+
+  /* Sparse kernel matrix... */
+  if (k_sp != NULL)
+    gsl_spblas_dgemv(trans, alpha, k_sp, x, beta, y);
+
+  /* Dense kernel matrix... */
+  else
+    gsl_blas_dgemv(trans, alpha, k, x, beta, y);
 }
 
 /*****************************************************************************/
@@ -451,9 +1345,8 @@ void optimal_estimation(
   obs_t *obs_meas,
   obs_t *obs_i,
   atm_t *atm_apr,
-  atm_t *atm_i) {
-
-  static int ipa[N], iqa[N];
+  atm_t *atm_i,
+  warm_t *warm) {
 
   FILE *out;
 
@@ -461,12 +1354,19 @@ void optimal_estimation(
 
   double chisq, disq = 0, lmpar = 0.001;
 
-  int it = 0;
+  int *ipa, *iqa, it = 0, kupd = 0, krecomp = 0, nkfull = 1, nkupd = 0,
+    kwarm = 0, conv = 0;
 
   /* ------------------------------------------------------------
      Initialize...
      ------------------------------------------------------------ */
 
+  /* Allocate... */
+  ALLOC(ipa, int,
+	N);
+  ALLOC(iqa, int,
+	N);
+
   /* Get sizes... */
   const size_t m = obs2y(ctl, obs_meas, NULL, NULL, NULL);
   const size_t n = atm2x(ctl, atm_apr, NULL, iqa, ipa);
@@ -483,10 +1383,12 @@ void optimal_estimation(
 		+ 2 * N * sizeof(int)) / 1024. / 1024.);
 
   /* Allocate... */
-  gsl_matrix *a = gsl_matrix_alloc(n, n);
-  gsl_matrix *cov = gsl_matrix_alloc(n, n);
-  gsl_matrix *k_i = gsl_matrix_alloc(m, n);
+  gsl_matrix *a = (ret->lm_solver != 2 ? gsl_matrix_alloc(n, n) : NULL);
+  gsl_matrix *cov = (ret->lm_solver != 2 ? gsl_matrix_alloc(n, n) : NULL);
+  gsl_matrix *k_i = (!ret->kernel_sparse ? gsl_matrix_alloc(m, n) : NULL);
+  gsl_spmatrix *k_sp = NULL, *s_a_chol = NULL;
   gsl_matrix *s_a_inv = gsl_matrix_alloc(n, n);
+  gsl_matrix *w_cg = (ret->lm_solver == 2 ? gsl_matrix_alloc(4, n) : NULL);
 
   gsl_vector *b = gsl_vector_alloc(n);
   gsl_vector *dx = gsl_vector_alloc(n);
@@ -500,6 +1402,64 @@ void optimal_estimation(
   gsl_vector *y_aux = gsl_vector_alloc(m);
   gsl_vector *y_i = gsl_vector_alloc(m);
   gsl_vector *y_m = gsl_vector_alloc(m);
+  gsl_vector *y_old = (ret->kernel_broyden ? gsl_vector_alloc(m) : NULL);
+
+  /* Allocate eigen-decomposition... */
+  gsl_eigen_gensymmv_workspace *w_eig = NULL;
+  gsl_matrix *b_eig = NULL, *v_eig = NULL;
+  gsl_vector *d_eig = NULL, *mu_eig = NULL, *vtb_eig = NULL, *z_eig = NULL;
+  if (ret->lm_solver == 1) {
+    w_eig = gsl_eigen_gensymmv_alloc(n);
+    b_eig = gsl_matrix_alloc(n, n);
+    v_eig = gsl_matrix_alloc(n, n);
+    d_eig = gsl_vector_alloc(n);
+    mu_eig = gsl_vector_alloc(n);
+    vtb_eig = gsl_vector_alloc(n);
+    z_eig = gsl_vector_alloc(n);
+  }
+
+  /* Allocate speculative trial steps... */
+  const int ns = ret->lm_nspec;
+  atm_t **atm_spec = NULL;
+  obs_t **obs_spec = NULL;
+  gsl_matrix **a_spec = NULL, **w_spec = NULL;
+  gsl_vector **dx_spec = NULL, **dy_spec = NULL, **x_spec = NULL,
+    **xs_i = NULL, **ys_i = NULL, **ya_spec = NULL, **z_spec = NULL;
+  double *chisq_spec = NULL;
+  if (ns > 1) {
+    ALLOC(a_spec, gsl_matrix *, ns);
+    ALLOC(w_spec, gsl_matrix *, ns);
+    ALLOC(ya_spec, gsl_vector *, ns);
+    ALLOC(z_spec, gsl_vector *, ns);
+    ALLOC(atm_spec, atm_t *, ns);
+    ALLOC(obs_spec, obs_t *, ns);
+    ALLOC(dx_spec, gsl_vector *, ns);
+    ALLOC(dy_spec, gsl_vector *, ns);
+    ALLOC(x_spec, gsl_vector *, ns);
+    ALLOC(xs_i, gsl_vector *, ns);
+    ALLOC(ys_i, gsl_vector *, ns);
+    ALLOC(chisq_spec, double,
+	  ns);
+    for (int is = 0; is < ns; is++) {
+      ALLOC(atm_spec[is], atm_t, 1);
+      ALLOC(obs_spec[is], obs_t, 1);
+      dx_spec[is] = gsl_vector_alloc(n);
+      dy_spec[is] = gsl_vector_alloc(m);
+      x_spec[is] = gsl_vector_alloc(n);
+      xs_i[is] = gsl_vector_alloc(n);
+      ys_i[is] = gsl_vector_alloc(m);
+
+      /* Solver workspace (first trial uses the common workspace)... */
+      a_spec[is] = (is > 0 && ret->lm_solver == 0
+		    ? gsl_matrix_alloc(n, n) : a);
+      w_spec[is] = (is > 0 && ret->lm_solver == 2
+		    ? gsl_matrix_alloc(4, n) : w_cg);
+      ya_spec[is] = (is > 0 && ret->lm_solver == 2
+		     ? gsl_vector_alloc(m) : y_aux);
+      z_spec[is] = (is > 0 && ret->lm_solver == 1
+		    ? gsl_vector_alloc(n) : z_eig);
+    }
+  }
 
   /* Set initial state... */
   copy_atm(ctl, atm_i, atm_apr, 0);
@@ -516,7 +1476,9 @@ void optimal_estimation(
   set_cov_apr(ret, ctl, atm_apr, iqa, ipa, s_a_inv);
   write_matrix(ret->dir, "matrix_cov_apr.tab", ctl, s_a_inv,
 	       atm_i, obs_i, "x", "x", "r");
-  matrix_invert(s_a_inv);
+  cov_apr_invert(ret, ctl, atm_apr, iqa, ipa, s_a_inv);
+  if (ret->lm_solver == 2)
+    s_a_chol = cov_apr_cholesky(s_a_inv, iqa);
 
   /* Get measurement errors... */
   set_cov_meas(ret, ctl, obs_meas, sig_noise, sig_formod, sig_eps_inv);
@@ -542,14 +1504,49 @@ void optimal_estimation(
   /* Compute cost function... */
   chisq = cost_function(dx, dy, s_a_inv, sig_eps_inv);
 
+  /* Warm start from converged state of previous profile... */
+  if (ret->warm && warm != NULL && warm_check(ret, warm, atm_apr)) {
+
+    /* Compute cost function for warm start... */
+    atm2x(ctl, warm->atm, x_step, NULL, NULL);
+    const double chisq_warm =
+      eval_state(ctl, atm_apr, obs_meas, x_a, y_m, s_a_inv, sig_eps_inv,
+		 x_step, atm_i, obs_i, y_i, dx, dy);
+
+    /* Use warm start if it reduces the cost function... */
+    if (chisq_warm < chisq) {
+      LOG(1, "%s: warm start from %s (chi^2/m= %g / a priori: %g)",
+	  ret->dir, warm->dir, chisq_warm, chisq);
+      gsl_vector_memcpy(x_i, x_step);
+      chisq = chisq_warm;
+      lmpar = warm->lmpar;
+      kwarm = (ret->warm == 2 && !ret->kernel_sparse
+	       && warm->k != NULL && warm->k->size1 == m
+	       && warm->k->size2 == n);
+    }
+
+    /* Fall back to a priori state... */
+    else {
+      LOG(1, "%s: warm start from %s rejected (chi^2/m= %g / a priori: %g)",
+	  ret->dir, warm->dir, chisq_warm, chisq);
+      chisq = eval_state(ctl, atm_apr, obs_meas, x_a, y_m, s_a_inv,
+			 sig_eps_inv, x_i, atm_i, obs_i, y_i, dx, dy);
+    }
+  }
+
   /* Write info... */
-  LOG(1, "it= %d / chi^2/m= %g", it, chisq);
+  LOG(1, "%s: it= %d / chi^2/m= %g", ret->dir, it, chisq);
 
   /* Write to cost function file... */
   fprintf(out, "%d %g %d %d\n", it, chisq, (int) m, (int) n);
 
-  /* Compute initial kernel... */
-  kernel(ctl, atm_i, obs_i, k_i);
+  /* Compute initial kernel (or take it from previous profile)... */
+  if (kwarm)
+    gsl_matrix_memcpy(k_i, warm->k);
+  else if (ret->kernel_sparse)
+    k_sp = kernel_sparse(ctl, atm_i, obs_i, ret->kernel_droptol);
+  else
+    kernel(ctl, atm_i, obs_i, k_i);
 
   /* ------------------------------------------------------------
      Levenberg-Marquardt minimization...
@@ -562,82 +1559,199 @@ void optimal_estimation(
     double chisq_old = chisq;
 
     /* Compute kernel matrix K_i... */
-    if (it > 1 && it % ret->kernel_recomp == 0)
-      kernel(ctl, atm_i, obs_i, k_i);
+    const int kfull = (it == 1 || it % ret->kernel_recomp == 0 || krecomp);
+    if (it > 1 && kfull) {
+      if (ret->kernel_sparse) {
+	gsl_spmatrix_free(k_sp);
+	k_sp = kernel_sparse(ctl, atm_i, obs_i, ret->kernel_droptol);
+      } else
+	kernel(ctl, atm_i, obs_i, k_i);
+      krecomp = kwarm = 0;
+      nkfull++;
+    }
 
     /* Compute K_i^T * S_eps^{-1} * K_i ... */
-    if (it == 1 || it % ret->kernel_recomp == 0)
-      matrix_product(k_i, sig_eps_inv, 1, cov);
+    if ((kfull || kupd) && ret->lm_solver != 2) {
+      if (ret->kernel_sparse)
+	matrix_product_sparse(k_sp, sig_eps_inv, cov);
+      else
+	matrix_product(k_i, sig_eps_inv, 1, cov);
+      kupd = 0;
+
+      /* Solve generalized eigenproblem K_i^T S_eps^{-1} K_i v = mu S_a^{-1} v
+         (the eigenvectors diagonalize both matrices)... */
+      if (ret->lm_solver == 1) {
+	gsl_matrix_memcpy(a, cov);
+	gsl_matrix_memcpy(b_eig, s_a_inv);
+	gsl_eigen_gensymmv(a, b_eig, mu_eig, v_eig, w_eig);
+
+	/* Get normalization d_j = v_j^T S_a^{-1} v_j ... */
+	gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0, s_a_inv, v_eig, 0.0,
+		       a);
+	for (size_t j = 0; j < n; j++) {
+	  double dj = 0;
+	  for (size_t i = 0; i < n; i++)
+	    dj += gsl_matrix_get(v_eig, i, j) * gsl_matrix_get(a, i, j);
+	  gsl_vector_set(d_eig, j, dj);
+	}
+      }
+    }
 
     /* Determine b = K_i^T * S_eps^{-1} * dy - S_a^{-1} * dx ... */
     for (size_t i = 0; i < m; i++)
       gsl_vector_set(y_aux, i, gsl_vector_get(dy, i)
 		     * POW2(gsl_vector_get(sig_eps_inv, i)));
-    gsl_blas_dgemv(CblasTrans, 1.0, k_i, y_aux, 0.0, b);
-    gsl_blas_dgemv(CblasNoTrans, -1.0, s_a_inv, dx, 1.0, b);
+    mult_kernel(k_i, k_sp, CblasTrans, 1.0, y_aux, 0.0, b);
+    if (ret->lm_solver == 2) {
+      gsl_vector_view aux = gsl_matrix_row(w_cg, 0);
+      mult_cov_apr_inv(s_a_chol, -1.0, dx, 1.0, b, &aux.vector);
+    } else
+      gsl_blas_dgemv(CblasNoTrans, -1.0, s_a_inv, dx, 1.0, b);
+
+    /* Project b onto eigenvectors... */
+    if (ret->lm_solver == 1)
+      gsl_blas_dgemv(CblasTrans, 1.0, v_eig, b, 0.0, vtb_eig);
+
+    /* Store current forward model result... */
+    if (ret->kernel_broyden)
+      gsl_vector_memcpy(y_old, y_i);
 
     /* Inner loop... */
-    for (int it2 = 0; it2 < 20; it2++) {
+    for (int it2 = 0; it2 < 20; it2 += ns) {
+
+      /* Loop over trial values of Levenberg-Marquardt parameter (several
+         trials are solved and evaluated in parallel, sharing the available
+         threads)... */
+      const int nt = omp_get_max_threads();
+#pragma omp parallel for num_threads(MIN(ns, nt)) if(ns > 1) default(shared)
+      for (int is = 0; is < ns; is++) {
+	const double lmtry = lmpar * pow(10., is);
+	gsl_vector *step = (ns > 1 ? x_spec[is] : x_step);
+	gsl_matrix *a_is = (ns > 1 ? a_spec[is] : a);
+	if (ns > 1)
+	  omp_set_num_threads(MAX(nt / ns, 1));
+
+	/* Solve A * x_step = b with eigen-decomposition, i.e.,
+	   x_step = sum_j v_j (v_j^T b) / (d_j (1 + lmpar + mu_j)) ... */
+	if (ret->lm_solver == 1) {
+	  gsl_vector *z_is = (ns > 1 ? z_spec[is] : z_eig);
+	  for (size_t j = 0; j < n; j++)
+	    gsl_vector_set(z_is, j, gsl_vector_get(vtb_eig, j)
+			   / (gsl_vector_get(d_eig, j)
+			      * (1 + lmtry + gsl_vector_get(mu_eig, j))));
+	  gsl_blas_dgemv(CblasNoTrans, 1.0, v_eig, z_is, 0.0, step);
+	}
+
+	/* Solve A * x_step = b by means of conjugate gradients... */
+	else if (ret->lm_solver == 2) {
+	  const int ncg =
+	    solve_cg(ret, k_i, k_sp, sig_eps_inv, s_a_chol, lmtry, b, step,
+		     ns > 1 ? w_spec[is] : w_cg, ns > 1 ? ya_spec[is] : y_aux);
+	  LOG(2, "lmpar= %g / CG iterations= %d", lmtry, ncg);
+	}
+
+	/* Solve A * x_step = b by means of Cholesky decomposition... */
+	else {
+
+	  /* Compute A = (1 + lmpar) * S_a^{-1} + K_i^T * S_eps^{-1} * K_i ... */
+	  gsl_matrix_memcpy(a_is, s_a_inv);
+	  gsl_matrix_scale(a_is, 1 + lmtry);
+	  gsl_matrix_add(a_is, cov);
 
-      /* Compute A = (1 + lmpar) * S_a^{-1} + K_i^T * S_eps^{-1} * K_i ... */
-      gsl_matrix_memcpy(a, s_a_inv);
-      gsl_matrix_scale(a, 1 + lmpar);
-      gsl_matrix_add(a, cov);
-
-      /* Solve A * x_step = b by means of Cholesky decomposition... */
-      gsl_linalg_cholesky_decomp(a);
-      gsl_linalg_cholesky_solve(a, b, x_step);
-
-      /* Update atmospheric state... */
-      gsl_vector_add(x_i, x_step);
-      copy_atm(ctl, atm_i, atm_apr, 0);
-      copy_obs(ctl, obs_i, obs_meas, 0);
-      x2atm(ctl, x_i, atm_i);
-
-      /* Check atmospheric state... */
-      for (int ip = 0; ip < atm_i->np; ip++) {
-	atm_i->p[ip] = MIN(MAX(atm_i->p[ip], 5e-7), 5e4);
-	atm_i->t[ip] = MIN(MAX(atm_i->t[ip], 100), 400);
-	for (int ig = 0; ig < ctl->ng; ig++)
-	  atm_i->q[ig][ip] = MIN(MAX(atm_i->q[ig][ip], 0), 1);
-	for (int iw = 0; iw < ctl->nw; iw++)
-	  atm_i->k[iw][ip] = MAX(atm_i->k[iw][ip], 0);
+	  /* Solve A * x_step = b ... */
+	  gsl_linalg_cholesky_decomp(a_is);
+	  gsl_linalg_cholesky_solve(a_is, b, step);
+	}
+
+	/* Update atmospheric state and compute cost function of trial... */
+	if (ns > 1) {
+	  gsl_vector_memcpy(xs_i[is], x_i);
+	  gsl_vector_add(xs_i[is], x_spec[is]);
+	  chisq_spec[is] =
+	    eval_state(ctl, atm_apr, obs_meas, x_a, y_m, s_a_inv, sig_eps_inv,
+		       xs_i[is], atm_spec[is], obs_spec[is], ys_i[is],
+		       dx_spec[is], dy_spec[is]);
+	}
       }
-      atm_i->clz = MAX(atm_i->clz, 0);
-      atm_i->cldz = MAX(atm_i->cldz, 0.1);
-      for (int icl = 0; icl < ctl->ncl; icl++)
-	atm_i->clk[icl] = MAX(atm_i->clk[icl], 0);
-      atm_i->sfz = MAX(atm_i->sfz, 0);
-      atm_i->sfp = MAX(atm_i->sfp, 0);
-      atm_i->sft = MIN(MAX(atm_i->sft, 100), 400);
-      for (int isf = 0; isf < ctl->nsf; isf++)
-	atm_i->sfeps[isf] = MIN(MAX(atm_i->sfeps[isf], 0), 1);
-
-      /* Forward calculation... */
-      formod(ctl, atm_i, obs_i);
-      obs2y(ctl, obs_i, y_i, NULL, NULL);
-
-      /* Determine dx = x_i - x_a and dy = y - F(x_i) ... */
-      gsl_vector_memcpy(dx, x_i);
-      gsl_vector_sub(dx, x_a);
-      gsl_vector_memcpy(dy, y_m);
-      gsl_vector_sub(dy, y_i);
-
-      /* Compute cost function... */
-      chisq = cost_function(dx, dy, s_a_inv, sig_eps_inv);
-
-      /* Modify Levenberg-Marquardt parameter... */
-      if (chisq > chisq_old) {
-	lmpar *= 10;
-	gsl_vector_sub(x_i, x_step);
-      } else {
-	lmpar /= 10;
-	break;
+
+      /* Evaluate single trial step... */
+      if (ns == 1) {
+
+	/* Update atmospheric state and compute cost function... */
+	gsl_vector_add(x_i, x_step);
+	chisq = eval_state(ctl, atm_apr, obs_meas, x_a, y_m, s_a_inv,
+			   sig_eps_inv, x_i, atm_i, obs_i, y_i, dx, dy);
+
+	/* Modify Levenberg-Marquardt parameter... */
+	if (chisq > chisq_old) {
+	  lmpar *= 10;
+	  gsl_vector_sub(x_i, x_step);
+	} else {
+	  lmpar /= 10;
+	  break;
+	}
+      }
+
+      /* Select one of several trial steps... */
+      else {
+
+	/* Select trial step with largest decrease of cost function... */
+	int ibest = -1;
+	for (int is = 0; is < ns; is++)
+	  if (chisq_spec[is] <= chisq_old
+	      && (ibest < 0 || chisq_spec[is] < chisq_spec[ibest]))
+	    ibest = is;
+
+	/* Copy selected (or last rejected) trial... */
+	const int isel = (ibest >= 0 ? ibest : ns - 1);
+	copy_atm(ctl, atm_i, atm_spec[isel], 0);
+	copy_obs(ctl, obs_i, obs_spec[isel], 0);
+	gsl_vector_memcpy(x_step, x_spec[isel]);
+	gsl_vector_memcpy(y_i, ys_i[isel]);
+	gsl_vector_memcpy(dx, dx_spec[isel]);
+	gsl_vector_memcpy(dy, dy_spec[isel]);
+	chisq = chisq_spec[isel];
+
+	/* Modify Levenberg-Marquardt parameter... */
+	if (ibest < 0)
+	  lmpar *= pow(10., ns);
+	else {
+	  gsl_vector_memcpy(x_i, xs_i[isel]);
+	  lmpar *= pow(10., isel) / 10;
+	  break;
+	}
+      }
+    }
+
+    /* Update kernel matrix... */
+    if (ret->kernel_broyden) {
+
+      /* Broyden update after accepted step, i.e.,
+         K_i += (F(x_i) - F(x_i - s) - K_i s) s^T / (s^T s) ... */
+      if (chisq <= chisq_old) {
+	double ss;
+	gsl_blas_ddot(x_step, x_step, &ss);
+	if (ss > 0) {
+	  gsl_vector_sub(y_old, y_i);
+	  gsl_blas_dgemv(CblasNoTrans, 1.0, k_i, x_step, 1.0, y_old);
+	  gsl_blas_dger(-1.0 / ss, y_old, x_step, k_i);
+	  kupd = 1;
+	  nkupd++;
+	}
       }
+
+      /* Recompute kernel if cost function stalls (decrease below 1%)... */
+      if (!kfull && chisq > 0.99 * chisq_old)
+	krecomp = 1;
     }
 
+    /* Recompute kernel taken from previous profile if cost function
+       stalls... */
+    if (kwarm && chisq > 0.99 * chisq_old)
+      krecomp = 1;
+
     /* Write info... */
-    LOG(1, "it= %d / chi^2/m= %g", it, chisq);
+    LOG(1, "%s: it= %d / chi^2/m= %g", ret->dir, it, chisq);
 
     /* Write to cost function file... */
     fprintf(out, "%d %g %d %d\n", it, chisq, (int) m, (int) n);
@@ -646,9 +1760,34 @@ void optimal_estimation(
     gsl_blas_ddot(x_step, b, &disq);
     disq /= (double) n;
 
-    /* Convergence test... */
-    if ((it == 1 || it % ret->kernel_recomp == 0) && disq < ret->conv_dmin)
-      break;
+    /* Convergence test (confirm with full kernel matrix)... */
+    if (disq < ret->conv_dmin) {
+      if (kfull && !kwarm) {
+	conv = 1;
+	break;
+      } else if (ret->kernel_broyden || kwarm)
+	krecomp = 1;
+    }
+  }
+
+  /* Write info... */
+  if (ret->kernel_broyden)
+    LOG(1, "Kernel matrix: full computations= %d / Broyden updates= %d",
+	nkfull, nkupd);
+
+  /* Store warm-start data for next profile... */
+  if (ret->warm && warm != NULL) {
+    strcpy(warm->dir, ret->dir);
+    warm->valid = conv;
+    copy_atm(ctl, warm->atm, atm_i, 0);
+    warm->lmpar = lmpar;
+    if (ret->warm == 2 && !ret->kernel_sparse) {
+      if (warm->k == NULL || warm->k->size1 != m || warm->k->size2 != n) {
+	gsl_matrix_free(warm->k);
+	warm->k = gsl_matrix_alloc(m, n);
+      }
+      gsl_matrix_memcpy(warm->k, k_i);
+    }
   }
 
   /* Close cost function file... */
@@ -657,73 +1796,21 @@ void optimal_estimation(
   /* Store results... */
   write_atm(ret->dir, "atm_final.tab", ctl, atm_i);
   write_obs(ret->dir, "obs_final.tab", ctl, obs_i);
-  write_matrix(ret->dir, "matrix_kernel.tab", ctl, k_i,
-	       atm_i, obs_i, "y", "x", "r");
+  if (ret->kernel_sparse)
+    write_matrix_sparse(ret->dir, "matrix_kernel.tab", ctl, k_sp,
+			atm_i, obs_i, "y", "x");
+  else
+    write_matrix(ret->dir, "matrix_kernel.tab", ctl, k_i,
+		 atm_i, obs_i, "y", "x", "r");
 
   /* ------------------------------------------------------------
      Analysis of retrieval results...
      ------------------------------------------------------------ */
 
-  /* Check if error analysis is requested... */
-  if (ret->err_ana) {
-
-    /* Allocate... */
-    gsl_matrix *auxnm = gsl_matrix_alloc(n, m);
-    gsl_matrix *corr = gsl_matrix_alloc(n, n);
-    gsl_matrix *gain = gsl_matrix_alloc(n, m);
-
-    /* Compute inverse retrieval covariance...
-       cov^{-1} = S_a^{-1} + K_i^T * S_eps^{-1} * K_i */
-    matrix_product(k_i, sig_eps_inv, 1, cov);
-    gsl_matrix_add(cov, s_a_inv);
-
-    /* Compute retrieval covariance... */
-    matrix_invert(cov);
-    write_matrix(ret->dir, "matrix_cov_ret.tab", ctl, cov,
-		 atm_i, obs_i, "x", "x", "r");
-    write_stddev("total", ret, ctl, atm_i, cov);
-
-    /* Compute correlation matrix... */
-    for (size_t i = 0; i < n; i++)
-      for (size_t j = 0; j < n; j++)
-	gsl_matrix_set(corr, i, j, gsl_matrix_get(cov, i, j)
-		       / sqrt(gsl_matrix_get(cov, i, i))
-		       / sqrt(gsl_matrix_get(cov, j, j)));
-    write_matrix(ret->dir, "matrix_corr.tab", ctl, corr,
-		 atm_i, obs_i, "x", "x", "r");
-
-    /* Compute gain matrix...
-       G = cov * K^T * S_eps^{-1} */
-    for (size_t i = 0; i < n; i++)
-      for (size_t j = 0; j < m; j++)
-	gsl_matrix_set(auxnm, i, j, gsl_matrix_get(k_i, j, i)
-		       * POW2(gsl_vector_get(sig_eps_inv, j)));
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0, cov, auxnm, 0.0, gain);
-    write_matrix(ret->dir, "matrix_gain.tab", ctl, gain,
-		 atm_i, obs_i, "x", "y", "c");
-
-    /* Compute retrieval error due to noise... */
-    matrix_product(gain, sig_noise, 2, a);
-    write_stddev("noise", ret, ctl, atm_i, a);
-
-    /* Compute retrieval error  due to forward model errors... */
-    matrix_product(gain, sig_formod, 2, a);
-    write_stddev("formod", ret, ctl, atm_i, a);
-
-    /* Compute averaging kernel matrix
-       A = G * K ... */
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0, gain, k_i, 0.0, a);
-    write_matrix(ret->dir, "matrix_avk.tab", ctl, a,
-		 atm_i, obs_i, "x", "x", "r");
-
-    /* Analyze averaging kernel matrix... */
-    analyze_avk(ret, ctl, atm_i, iqa, ipa, a);
-
-    /* Free... */
-    gsl_matrix_free(auxnm);
-    gsl_matrix_free(corr);
-    gsl_matrix_free(gain);
-  }
+  /* Carry out error analysis... */
+  if (ret->err_ana)
+    analyze_errors(ret, ctl, atm_i, obs_i, iqa, ipa, k_i, k_sp, s_a_inv,
+		   sig_eps_inv, sig_noise, sig_formod);
 
   /* ------------------------------------------------------------
      Finalize...
@@ -732,7 +1819,10 @@ void optimal_estimation(
   gsl_matrix_free(a);
   gsl_matrix_free(cov);
   gsl_matrix_free(k_i);
+  gsl_spmatrix_free(k_sp);
+  gsl_spmatrix_free(s_a_chol);
   gsl_matrix_free(s_a_inv);
+  gsl_matrix_free(w_cg);
 
   gsl_vector_free(b);
   gsl_vector_free(dx);
@@ -746,6 +1836,323 @@ void optimal_estimation(
   gsl_vector_free(y_aux);
   gsl_vector_free(y_i);
   gsl_vector_free(y_m);
+  if (ret->kernel_broyden)
+    gsl_vector_free(y_old);
+
+  if (ret->lm_solver == 1) {
+    gsl_eigen_gensymmv_free(w_eig);
+    gsl_matrix_free(b_eig);
+    gsl_matrix_free(v_eig);
+    gsl_vector_free(d_eig);
+    gsl_vector_free(mu_eig);
+    gsl_vector_free(vtb_eig);
+    gsl_vector_free(z_eig);
+  }
+
+  if (ns > 1) {
+    for (int is = 0; is < ns; is++) {
+      free(atm_spec[is]);
+      free(obs_spec[is]);
+      gsl_vector_free(dx_spec[is]);
+      gsl_vector_free(dy_spec[is]);
+      gsl_vector_free(x_spec[is]);
+      gsl_vector_free(xs_i[is]);
+      gsl_vector_free(ys_i[is]);
+      if (a_spec[is] != a)
+	gsl_matrix_free(a_spec[is]);
+      if (w_spec[is] != w_cg)
+	gsl_matrix_free(w_spec[is]);
+      if (ya_spec[is] != y_aux)
+	gsl_vector_free(ya_spec[is]);
+      if (z_spec[is] != z_eig)
+	gsl_vector_free(z_spec[is]);
+    }
+    free(a_spec);
+    free(w_spec);
+    free(ya_spec);
+    free(z_spec);
+    free(atm_spec);
+    free(obs_spec);
+    free(dx_spec);
+    free(dy_spec);
+    free(x_spec);
+    free(xs_i);
+    free(ys_i);
+    free(chisq_spec);
+  }
+
+  free(ipa);
+  free(iqa);
+}
+
+/*****************************************************************************/
+
+void optimal_estimation_batch(
+  ctl_t *ctl,
+  prof_t *prof,
+  int np) {
+
+  int *ia;
+
+  size_t *off;
+
+  /* Allocate... */
+  ALLOC(ia, int,
+	np);
+  ALLOC(off, size_t,
+	np + 1);
+
+  /* Write info... */
+  LOG(1, "Batch retrieval: profiles= %d", np);
+
+  /* ------------------------------------------------------------
+     Initialize...
+     ------------------------------------------------------------ */
+
+#pragma omp parallel for schedule(dynamic, 1) default(shared)
+  for (int ip = 0; ip < np; ip++) {
+
+    prof_t *p = &prof[ip];
+
+    char filename[2 * LEN];
+
+    /* Get sizes... */
+    ALLOC(p->ipa, int,
+	  N);
+    ALLOC(p->iqa, int,
+	  N);
+    const size_t m = p->m = obs2y(ctl, p->obs_meas, NULL, NULL, NULL);
+    const size_t n = p->n = atm2x(ctl, p->atm_apr, NULL, p->iqa, p->ipa);
+    if (m == 0 || n == 0)
+      ERRMSG("Check problem definition!");
+
+    /* Allocate... */
+    p->a = gsl_matrix_alloc(n, n);
+    p->cov = gsl_matrix_alloc(n, n);
+    p->k_i = gsl_matrix_alloc(m, n);
+    p->s_a_inv = gsl_matrix_alloc(n, n);
+    p->b = gsl_vector_alloc(n);
+    p->dx = gsl_vector_alloc(n);
+    p->dy = gsl_vector_alloc(m);
+    p->sig_eps_inv = gsl_vector_alloc(m);
+    p->sig_formod = gsl_vector_alloc(m);
+    p->sig_noise = gsl_vector_alloc(m);
+    p->x_a = gsl_vector_alloc(n);
+    p->x_i = gsl_vector_alloc(n);
+    p->x_step = gsl_vector_alloc(n);
+    p->y_aux = gsl_vector_alloc(m);
+    p->y_i = gsl_vector_alloc(m);
+    p->y_m = gsl_vector_alloc(m);
+
+    /* Set initial state... */
+    copy_atm(ctl, p->atm_i, p->atm_apr, 0);
+    copy_obs(ctl, p->obs_i, p->obs_meas, 0);
+    formod(ctl, p->atm_i, p->obs_i);
+
+    /* Set state vectors and observation vectors... */
+    atm2x(ctl, p->atm_apr, p->x_a, NULL, NULL);
+    atm2x(ctl, p->atm_i, p->x_i, NULL, NULL);
+    obs2y(ctl, p->obs_meas, p->y_m, NULL, NULL);
+    obs2y(ctl, p->obs_i, p->y_i, NULL, NULL);
+
+    /* Set inverse a priori covariance S_a^-1... */
+    set_cov_apr(p->ret, ctl, p->atm_apr, p->iqa, p->ipa, p->s_a_inv);
+    write_matrix(p->ret->dir, "matrix_cov_apr.tab", ctl, p->s_a_inv,
+		 p->atm_i, p->obs_i, "x", "x", "r");
+    cov_apr_invert(p->ret, ctl, p->atm_apr, p->iqa, p->ipa, p->s_a_inv);
+
+    /* Get measurement errors... */
+    set_cov_meas(p->ret, ctl, p->obs_meas, p->sig_noise, p->sig_formod,
+		 p->sig_eps_inv);
+
+    /* Create cost function file... */
+    sprintf(filename, "%s/costs.tab", p->ret->dir);
+    if (!(p->out = fopen(filename, "w")))
+      ERRMSG("Cannot create cost function file!");
+    fprintf(p->out,
+	    "# $1 = iteration number\n"
+	    "# $2 = normalized cost function\n"
+	    "# $3 = number of measurements\n"
+	    "# $4 = number of state vector elements\n\n");
+
+    /* Determine dx = x_i - x_a and dy = y - F(x_i) ... */
+    gsl_vector_memcpy(p->dx, p->x_i);
+    gsl_vector_sub(p->dx, p->x_a);
+    gsl_vector_memcpy(p->dy, p->y_m);
+    gsl_vector_sub(p->dy, p->y_i);
+
+    /* Compute cost function... */
+    p->chisq = cost_function(p->dx, p->dy, p->s_a_inv, p->sig_eps_inv);
+    LOG(1, "%s: it= %d / chi^2/m= %g", p->ret->dir, 0, p->chisq);
+    fprintf(p->out, "%d %g %d %d\n", 0, p->chisq, (int) m, (int) n);
+
+    /* Set Levenberg-Marquardt parameter... */
+    p->lmpar = 0.001;
+    p->active = 1;
+  }
+
+  /* ------------------------------------------------------------
+     Levenberg-Marquardt minimization...
+     ------------------------------------------------------------ */
+
+  /* Outer loop... */
+  for (int it = 1; it <= prof[0].ret->conv_itmax; it++) {
+
+    /* Get active profiles... */
+    int nact = 0;
+    for (int ip = 0; ip < np; ip++)
+      if (prof[ip].active)
+	ia[nact++] = ip;
+    if (nact == 0)
+      break;
+
+    /* Compute kernel matrices of all active profiles with a single
+       work queue over the stacked columns (the step vector holds
+       the unperturbed state vector)... */
+    const int kfull = (it == 1 || it % prof[0].ret->kernel_recomp == 0);
+    if (kfull) {
+      off[0] = 0;
+      for (int i = 0; i < nact; i++) {
+	prof_t *p = &prof[ia[i]];
+	atm2x(ctl, p->atm_i, p->x_step, NULL, NULL);
+	off[i + 1] = off[i] + p->n;
+      }
+#pragma omp parallel for schedule(dynamic, 1) default(shared)
+      for (size_t jj = 0; jj < off[nact]; jj++) {
+	int i = 0;
+	while (jj >= off[i + 1])
+	  i++;
+	prof_t *p = &prof[ia[i]];
+	const size_t j = jj - off[i];
+	gsl_vector_view kj = gsl_matrix_column(p->k_i, j);
+	kernel_column(ctl, p->atm_i, p->obs_i, p->x_step, p->y_i, p->iqa[j],
+		      j, &kj.vector);
+      }
+    }
+
+    /* Set up normal equations of the diagonal blocks... */
+#pragma omp parallel for schedule(dynamic, 1) default(shared)
+    for (int i = 0; i < nact; i++) {
+      prof_t *p = &prof[ia[i]];
+
+      /* Store current cost function value... */
+      p->chisq_old = p->chisq;
+      p->accept = 0;
+
+      /* Compute K_i^T * S_eps^{-1} * K_i ... */
+      if (kfull)
+	matrix_product(p->k_i, p->sig_eps_inv, 1, p->cov);
+
+      /* Determine b = K_i^T * S_eps^{-1} * dy - S_a^{-1} * dx ... */
+      for (size_t k = 0; k < p->m; k++)
+	gsl_vector_set(p->y_aux, k, gsl_vector_get(p->dy, k)
+		       * POW2(gsl_vector_get(p->sig_eps_inv, k)));
+      gsl_blas_dgemv(CblasTrans, 1.0, p->k_i, p->y_aux, 0.0, p->b);
+      gsl_blas_dgemv(CblasNoTrans, -1.0, p->s_a_inv, p->dx, 1.0, p->b);
+    }
+
+    /* Inner loop (all profiles without accepted step)... */
+    for (int it2 = 0; it2 < 20; it2++) {
+
+      int nrej = 0;
+
+#pragma omp parallel for schedule(dynamic, 1) default(shared) reduction(+:nrej)
+      for (int i = 0; i < nact; i++) {
+	prof_t *p = &prof[ia[i]];
+	if (p->accept)
+	  continue;
+
+	/* Compute A = (1 + lmpar) * S_a^{-1} + K_i^T * S_eps^{-1} * K_i ... */
+	gsl_matrix_memcpy(p->a, p->s_a_inv);
+	gsl_matrix_scale(p->a, 1 + p->lmpar);
+	gsl_matrix_add(p->a, p->cov);
+
+	/* Solve A * x_step = b by means of Cholesky decomposition... */
+	gsl_linalg_cholesky_decomp(p->a);
+	gsl_linalg_cholesky_solve(p->a, p->b, p->x_step);
+
+	/* Update atmospheric state and compute cost function... */
+	gsl_vector_add(p->x_i, p->x_step);
+	p->chisq = eval_state(ctl, p->atm_apr, p->obs_meas, p->x_a,
+			      p->y_m, p->s_a_inv, p->sig_eps_inv, p->x_i,
+			      p->atm_i, p->obs_i, p->y_i, p->dx, p->dy);
+
+	/* Modify Levenberg-Marquardt parameter... */
+	if (p->chisq > p->chisq_old) {
+	  p->lmpar *= 10;
+	  gsl_vector_sub(p->x_i, p->x_step);
+	  nrej++;
+	} else {
+	  p->lmpar /= 10;
+	  p->accept = 1;
+	}
+      }
+
+      /* Check if all steps have been accepted... */
+      if (nrej == 0)
+	break;
+    }
+
+    /* Write info and check convergence... */
+    for (int i = 0; i < nact; i++) {
+      prof_t *p = &prof[ia[i]];
+      LOG(1, "%s: it= %d / chi^2/m= %g", p->ret->dir, it, p->chisq);
+      fprintf(p->out, "%d %g %d %d\n", it, p->chisq, (int) p->m,
+	      (int) p->n);
+      double disq;
+      gsl_blas_ddot(p->x_step, p->b, &disq);
+      if (disq / (double) p->n < p->ret->conv_dmin && kfull)
+	p->active = 0;
+    }
+  }
+
+  /* ------------------------------------------------------------
+     Store results and finalize...
+     ------------------------------------------------------------ */
+
+#pragma omp parallel for schedule(dynamic, 1) default(shared)
+  for (int ip = 0; ip < np; ip++) {
+    prof_t *p = &prof[ip];
+
+    /* Close cost function file... */
+    fclose(p->out);
+
+    /* Store results... */
+    write_atm(p->ret->dir, "atm_final.tab", ctl, p->atm_i);
+    write_obs(p->ret->dir, "obs_final.tab", ctl, p->obs_i);
+    write_matrix(p->ret->dir, "matrix_kernel.tab", ctl, p->k_i,
+		 p->atm_i, p->obs_i, "y", "x", "r");
+
+    /* Carry out error analysis... */
+    if (p->ret->err_ana)
+      analyze_errors(p->ret, ctl, p->atm_i, p->obs_i, p->iqa, p->ipa,
+		     p->k_i, NULL, p->s_a_inv, p->sig_eps_inv, p->sig_noise,
+		     p->sig_formod);
+
+    /* Free... */
+    gsl_matrix_free(p->a);
+    gsl_matrix_free(p->cov);
+    gsl_matrix_free(p->k_i);
+    gsl_matrix_free(p->s_a_inv);
+    gsl_vector_free(p->b);
+    gsl_vector_free(p->dx);
+    gsl_vector_free(p->dy);
+    gsl_vector_free(p->sig_eps_inv);
+    gsl_vector_free(p->sig_formod);
+    gsl_vector_free(p->sig_noise);
+    gsl_vector_free(p->x_a);
+    gsl_vector_free(p->x_i);
+    gsl_vector_free(p->x_step);
+    gsl_vector_free(p->y_aux);
+    gsl_vector_free(p->y_i);
+    gsl_vector_free(p->y_m);
+    free(p->ipa);
+    free(p->iqa);
+  }
+
+  /* Free... */
+  free(ia);
+  free(off);
 }
 
 /*****************************************************************************/
@@ -756,9 +2163,49 @@ void read_ret(
   ctl_t *ctl,
   ret_t *ret) {
 
+  /* Parallelization and restart... */
+  ret->nprof = (int) scan_ctl(argc, argv, "RET_NPROF", -1, "1", NULL);
+  if (ret->nprof < 1)
+    ERRMSG("Set RET_NPROF >= 1!");
+  ret->nthrd = (int) scan_ctl(argc, argv, "RET_NTHRD", -1, "0", NULL);
+  ret->resume = (int) scan_ctl(argc, argv, "RET_RESUME", -1, "0", NULL);
+  ret->batch = (int) scan_ctl(argc, argv, "RET_BATCH", -1, "1", NULL);
+  if (ret->batch < 1)
+    ERRMSG("Set RET_BATCH >= 1!");
+  ret->warm = (int) scan_ctl(argc, argv, "RET_WARM", -1, "0", NULL);
+  if (ret->warm < 0 || ret->warm > 2)
+    ERRMSG("Set RET_WARM to 0 (off), 1 (first guess),"
+	   " or 2 (first guess and kernel)!");
+  if (ret->warm && ret->batch > 1)
+    ERRMSG("Warm start requires RET_BATCH 1!");
+  ret->warm_dmax =
+    scan_ctl(argc, argv, "RET_WARM_DMAX", -1, "500", NULL);
+
   /* Iteration control... */
   ret->kernel_recomp =
     (int) scan_ctl(argc, argv, "KERNEL_RECOMP", -1, "3", NULL);
+  ret->kernel_broyden =
+    (int) scan_ctl(argc, argv, "KERNEL_BROYDEN", -1, "0", NULL);
+  ret->kernel_sparse =
+    (int) scan_ctl(argc, argv, "KERNEL_SPARSE", -1, "0", NULL);
+  ret->kernel_droptol =
+    scan_ctl(argc, argv, "KERNEL_DROPTOL", -1, "1e-6", NULL);
+  if (ret->kernel_sparse && ret->kernel_broyden)
+    ERRMSG("Broyden updates require dense kernel matrix (KERNEL_SPARSE 0)!");
+  ret->lm_solver = (int) scan_ctl(argc, argv, "LM_SOLVER", -1, "0", NULL);
+  if (ret->lm_solver < 0 || ret->lm_solver > 2)
+    ERRMSG("Set LM_SOLVER to 0 (Cholesky), 1 (eigen-decomposition),"
+	   " or 2 (conjugate gradients)!");
+  ret->lm_cg_tol = scan_ctl(argc, argv, "LM_CG_TOL", -1, "1e-6", NULL);
+  if (ret->lm_cg_tol <= 0)
+    ERRMSG("Set LM_CG_TOL > 0!");
+  ret->lm_nspec = (int) scan_ctl(argc, argv, "LM_NSPEC", -1, "1", NULL);
+  if (ret->lm_nspec < 1 || ret->lm_nspec > 20)
+    ERRMSG("Set 1 <= LM_NSPEC <= 20!");
+  if (ret->batch > 1 && (ret->lm_solver != 0 || ret->lm_nspec != 1
+			 || ret->kernel_broyden || ret->kernel_sparse))
+    ERRMSG("Batch retrieval requires LM_SOLVER 0, LM_NSPEC 1,"
+	   " KERNEL_BROYDEN 0, and KERNEL_SPARSE 0!");
   ret->conv_itmax = (int) scan_ctl(argc, argv, "CONV_ITMAX", -1, "30", NULL);
   ret->conv_dmin = scan_ctl(argc, argv, "CONV_DMIN", -1, "0.1", NULL);
 
@@ -805,6 +2252,33 @@ void read_ret(
 
 /*****************************************************************************/
 
+int read_status(
+  ret_t *ret) {
+
+  FILE *in;
+
+  char filename[2 * LEN], line[LEN];
+
+  int status = 0;
+
+  /* Open file... */
+  sprintf(filename, "%s/ret_status.tab", ret->dir);
+  if (!(in = fopen(filename, "r")))
+    return -1;
+
+  /* Read status... */
+  while (fgets(line, LEN, in))
+    if (line[0] != '#')
+      sscanf(line, "%d", &status);
+
+  /* Close file... */
+  fclose(in);
+
+  return status;
+}
+
+/*****************************************************************************/
+
 void set_cov_apr(
   ret_t *ret,
   ctl_t *ctl,
@@ -813,7 +2287,9 @@ void set_cov_apr(
   int *ipa,
   gsl_matrix *s_a) {
 
-  double x0[3], x1[3];
+  double *xc, cz, ch;
+
+  size_t i1;
 
   /* Get sizes... */
   const size_t n = s_a->size1;
@@ -862,60 +2338,46 @@ void set_cov_apr(
   for (size_t i = 0; i < n; i++)
     gsl_matrix_set(s_a, i, i, POW2(gsl_vector_get(x_a, i)));
 
-  /* Loop over matrix elements... */
+  /* Get Cartesian coordinates... */
+  ALLOC(xc, double,
+	3 * n);
   for (size_t i = 0; i < n; i++)
-    for (size_t j = 0; j < n; j++)
-      if (i != j && iqa[i] == iqa[j]) {
-
-	/* Initialize... */
-	double cz = 0;
-	double ch = 0;
-
-	/* Set correlation lengths for pressure... */
-	if (iqa[i] == IDXP) {
-	  cz = ret->err_press_cz;
-	  ch = ret->err_press_ch;
-	}
+    geo2cart(0, atm->lon[ipa[i]], atm->lat[ipa[i]], &xc[3 * i]);
 
-	/* Set correlation lengths for temperature... */
-	if (iqa[i] == IDXT) {
-	  cz = ret->err_temp_cz;
-	  ch = ret->err_temp_ch;
-	}
-
-	/* Set correlation lengths for volume mixing ratios... */
-	for (int ig = 0; ig < ctl->ng; ig++)
-	  if (iqa[i] == IDXQ(ig)) {
-	    cz = ret->err_q_cz[ig];
-	    ch = ret->err_q_ch[ig];
-	  }
+  /* Loop over blocks of state vector elements of the same quantity... */
+  for (size_t i0 = 0; i0 < n; i0 = i1) {
 
-	/* Set correlation lengths for extinction... */
-	for (int iw = 0; iw < ctl->nw; iw++)
-	  if (iqa[i] == IDXK(iw)) {
-	    cz = ret->err_k_cz[iw];
-	    ch = ret->err_k_ch[iw];
-	  }
+    /* Find end of block... */
+    i1 = i0 + 1;
+    while (i1 < n && iqa[i1] == iqa[i0])
+      i1++;
 
-	/* Compute correlations... */
-	if (cz > 0 && ch > 0) {
+    /* Get correlation lengths... */
+    corr_len(ret, ctl, iqa[i0], &cz, &ch);
 
-	  /* Get Cartesian coordinates... */
-	  geo2cart(0, atm->lon[ipa[i]], atm->lat[ipa[i]], x0);
-	  geo2cart(0, atm->lon[ipa[j]], atm->lat[ipa[j]], x1);
+    /* Compute correlations (only the diagonal is needed for blocks with
+       tridiagonal inverse, unless the matrix is written)... */
+    if (cz > 0 && ch > 0
+	&& (ctl->write_matrix || !cov_apr_tri(atm, ipa, i0, i1)))
+      for (size_t i = i0; i < i1; i++)
+	for (size_t j = i + 1; j < i1; j++) {
 
 	  /* Compute correlations... */
+	  const double *x0 = &xc[3 * i], *x1 = &xc[3 * j];
 	  double rho =
 	    exp(-DIST(x0, x1) / ch -
 		fabs(atm->z[ipa[i]] - atm->z[ipa[j]]) / cz);
 
 	  /* Set covariance... */
-	  gsl_matrix_set(s_a, i, j, gsl_vector_get(x_a, i)
-			 * gsl_vector_get(x_a, j) * rho);
+	  const double cov = gsl_vector_get(x_a, i)
+	    * gsl_vector_get(x_a, j) * rho;
+	  gsl_matrix_set(s_a, i, j, cov);
+	  gsl_matrix_set(s_a, j, i, cov);
 	}
-      }
+  }
 
   /* Free... */
+  free(xc);
   gsl_vector_free(x_a);
 }
 
@@ -929,26 +2391,29 @@ void set_cov_meas(
   gsl_vector *sig_formod,
   gsl_vector *sig_eps_inv) {
 
-  static obs_t obs_err;
+  obs_t *obs_err;
 
   /* Get size... */
   const size_t m = sig_eps_inv->size;
 
+  /* Allocate... */
+  ALLOC(obs_err, obs_t, 1);
+
   /* Noise error (always considered in retrieval fit)... */
-  copy_obs(ctl, &obs_err, obs, 1);
-  for (int ir = 0; ir < obs_err.nr; ir++)
+  copy_obs(ctl, obs_err, obs, 1);
+  for (int ir = 0; ir < obs_err->nr; ir++)
     for (int id = 0; id < ctl->nd; id++)
-      obs_err.rad[id][ir]
+      obs_err->rad[id][ir]
 	= (isfinite(obs->rad[id][ir]) ? ret->err_noise[id] : NAN);
-  obs2y(ctl, &obs_err, sig_noise, NULL, NULL);
+  obs2y(ctl, obs_err, sig_noise, NULL, NULL);
 
   /* Forward model error (always considered in retrieval fit)... */
-  copy_obs(ctl, &obs_err, obs, 1);
-  for (int ir = 0; ir < obs_err.nr; ir++)
+  copy_obs(ctl, obs_err, obs, 1);
+  for (int ir = 0; ir < obs_err->nr; ir++)
     for (int id = 0; id < ctl->nd; id++)
-      obs_err.rad[id][ir]
+      obs_err->rad[id][ir]
 	= fabs(ret->err_formod[id] / 100 * obs->rad[id][ir]);
-  obs2y(ctl, &obs_err, sig_formod, NULL, NULL);
+  obs2y(ctl, obs_err, sig_formod, NULL, NULL);
 
   /* Total error... */
   for (size_t i = 0; i < m; i++)
@@ -961,6 +2426,148 @@ void set_cov_meas(
   for (size_t i = 0; i < m; i++)
     if (gsl_vector_get(sig_eps_inv, i) <= 0)
       ERRMSG("Check measurement errors (zero standard deviation)!");
+
+  /* Free... */
+  free(obs_err);
+}
+
+/*****************************************************************************/
+
+int solve_cg(
+  ret_t *ret,
+  gsl_matrix *k,
+  gsl_spmatrix *k_sp,
+  gsl_vector *sig_eps_inv,
+  gsl_spmatrix *s_a_chol,
+  double lmpar,
+  gsl_vector *b,
+  gsl_vector *x,
+  gsl_matrix *work,
+  gsl_vector *y_aux) {
+
+  double bnorm, rnorm = 0, rz;
+
+  int icg;
+
+  /* Get sizes... */
+  const size_t m = sig_eps_inv->size;
+  const size_t n = b->size;
+
+  /* Get work vectors... */
+  gsl_vector_view pv = gsl_matrix_row(work, 0);
+  gsl_vector_view qv = gsl_matrix_row(work, 1);
+  gsl_vector_view rv = gsl_matrix_row(work, 2);
+  gsl_vector_view zv = gsl_matrix_row(work, 3);
+  gsl_vector *p = &pv.vector, *q = &qv.vector, *r = &rv.vector,
+    *z = &zv.vector;
+
+  /* Initialize (x = 0, r = b, z = S_a r, p = z)... */
+  gsl_vector_set_zero(x);
+  gsl_vector_memcpy(r, b);
+  gsl_vector_memcpy(z, r);
+  mult_cov_apr(s_a_chol, z);
+  gsl_vector_memcpy(p, z);
+  gsl_blas_ddot(r, z, &rz);
+  bnorm = gsl_blas_dnrm2(b);
+
+  /* Iterate... */
+  for (icg = 1; icg <= (int) n && bnorm > 0; icg++) {
+
+    /* Compute q = A p = (1 + lmpar) S_a^{-1} p + K^T S_eps^{-1} K p ... */
+    mult_kernel(k, k_sp, CblasNoTrans, 1.0, p, 0.0, y_aux);
+    for (size_t i = 0; i < m; i++)
+      gsl_vector_set(y_aux, i, gsl_vector_get(y_aux, i)
+		     * POW2(gsl_vector_get(sig_eps_inv, i)));
+    mult_kernel(k, k_sp, CblasTrans, 1.0, y_aux, 0.0, q);
+    mult_cov_apr_inv(s_a_chol, 1 + lmpar, p, 1.0, q, z);
+
+    /* Update solution and residual... */
+    double pq;
+    gsl_blas_ddot(p, q, &pq);
+    const double alpha = rz / pq;
+    gsl_blas_daxpy(alpha, p, x);
+    gsl_blas_daxpy(-alpha, q, r);
+
+    /* Check convergence... */
+    rnorm = gsl_blas_dnrm2(r);
+    if (rnorm <= ret->lm_cg_tol * bnorm)
+      break;
+
+    /* Apply preconditioner z = S_a r ... */
+    gsl_vector_memcpy(z, r);
+    mult_cov_apr(s_a_chol, z);
+
+    /* Update search direction... */
+    const double rz_old = rz;
+    gsl_blas_ddot(r, z, &rz);
+    gsl_vector_scale(p, rz / rz_old);
+    gsl_vector_add(p, z);
+  }
+
+  /* Check iteration limit... */
+  if (rnorm > ret->lm_cg_tol * bnorm)
+    WARN("CG solver did not converge (|r|/|b|= %g after %d iterations)!",
+	 rnorm / bnorm, (int) n);
+
+  return MIN(icg, (int) n);
+}
+
+/*****************************************************************************/
+
+int warm_check(
+  ret_t *ret,
+  warm_t *warm,
+  atm_t *atm_apr) {
+
+  double x0[3], x1[3];
+
+  /* Check if previous retrieval converged... */
+  if (!warm->valid)
+    return 0;
+
+  /* Check altitude grid (same state vector layout)... */
+  if (warm->atm->np != atm_apr->np)
+    return 0;
+  for (int ip = 0; ip < atm_apr->np; ip++)
+    if (warm->atm->z[ip] != atm_apr->z[ip])
+      return 0;
+
+  /* Check horizontal distance... */
+  geo2cart(0, warm->atm->lon[0], warm->atm->lat[0], x0);
+  geo2cart(0, atm_apr->lon[0], atm_apr->lat[0], x1);
+  if (DIST(x0, x1) > ret->warm_dmax) {
+    LOG(1, "Warm start from %s rejected (distance= %g km)", warm->dir,
+	DIST(x0, x1));
+    return 0;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************/
+
+void write_status(
+  ret_t *ret,
+  int status,
+  double dt) {
+
+  FILE *out;
+
+  char filename[2 * LEN];
+
+  /* Create file... */
+  sprintf(filename, "%s/ret_status.tab", ret->dir);
+  if (!(out = fopen(filename, "w")))
+    ERRMSG("Cannot create status file!");
+
+  /* Write status... */
+  fprintf(out,
+	  "# $1 = retrieval status (0=started, 1=done)\n"
+	  "# $2 = wall-clock time [s]\n\n");
+  fprintf(out, "%d %g\n", status, dt);
+
+  /* Close file... */
+  fclose(out);
 }
 
 /*****************************************************************************/
@@ -972,7 +2579,7 @@ void write_stddev(
   atm_t *atm,
   gsl_matrix *s) {
 
-  static atm_t atm_aux;
+  atm_t *atm_aux;
 
   char filename[LEN];
 
@@ -980,6 +2587,7 @@ void write_stddev(
   const size_t n = s->size1;
 
   /* Allocate... */
+  ALLOC(atm_aux, atm_t, 1);
   gsl_vector *x_aux = gsl_vector_alloc(n);
 
   /* Compute standard deviation... */
@@ -987,11 +2595,12 @@ void write_stddev(
     gsl_vector_set(x_aux, i, sqrt(gsl_matrix_get(s, i, i)));
 
   /* Write to disk... */
-  copy_atm(ctl, &atm_aux, atm, 1);
-  x2atm(ctl, x_aux, &atm_aux);
+  copy_atm(ctl, atm_aux, atm, 1);
+  x2atm(ctl, x_aux, atm_aux);
   sprintf(filename, "atm_err_%s.tab", quantity);
-  write_atm(ret->dir, filename, ctl, &atm_aux);
+  write_atm(ret->dir, filename, ctl, atm_aux);
 
   /* Free... */
+  free(atm_aux);
   gsl_vector_free(x_aux);
 }
@@ -0,0 +1,272 @@
+/*
+  This file is part of JURASSIC.
+  
+  JURASSIC is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  JURASSIC is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with JURASSIC. If not, see <http://www.gnu.org/licenses/>.
+  
+  Copyright (C) 2003-2025 Forschungszentrum Juelich GmbH
+*/
+
+
+/*! 
+  \file
+  Compare and benchmark memory layouts and placement of the emissivity
+  look-up tables.
+*/
+
+#include "jurassic.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+/* ------------------------------------------------------------
+   Functions...
+   ------------------------------------------------------------ */
+
+/*! Open hardware cache miss counter (returns -1 if not available). */
+int counter_open(
+  void);
+
+/*! Read hardware cache miss counter. */
+double counter_read(
+  const int fd);
+
+/* ------------------------------------------------------------
+   Main...
+   ------------------------------------------------------------ */
+
+int main(
+  int argc,
+  char *argv[]) {
+
+  static atm_t atm;
+  static ctl_t ctl;
+  static obs_t obs;
+
+  static double tau_path[2][NR][ND][NG], tau_seg[ND];
+
+  double dt[2] = { 0, 0 }, miss[2] = { 0, 0 }, dmax = 0,
+    npts[NNODE], tnode[NNODE];
+
+  los_t *los;
+
+  tbl_t *tbl[2];
+
+  int fd[2], nthrd[NNODE], np = 0;
+
+  /* Check arguments... */
+  if (argc < 4)
+    ERRMSG("Give parameters: <ctl> <obs> <atm>");
+
+  /* Read control parameters... */
+  read_ctl(argc, argv, &ctl);
+  const int nrep = (int) scan_ctl(argc, argv, "NREP", -1, "10", NULL);
+
+  /* Check forward model... */
+  if (ctl.formod != 0 && ctl.formod != 1)
+    ERRMSG("Set FORMOD to 0 (CGA) or 1 (EGA)!");
+
+  /* Read observation geometry and atmospheric data... */
+  read_obs(NULL, argv[2], &ctl, &obs);
+  read_atm(NULL, argv[3], &ctl, &atm);
+  hydrostatic(&ctl, &atm);
+
+  /* Allocate... */
+  ALLOC(los, los_t, 1);
+
+  /* Read look-up tables (channel-outer and channel-inner layout, requested
+     placement for the requested layout)... */
+  const int layout = ctl.tbllayout, numa = ctl.tblnuma;
+  for (int il = 0; il < 2; il++) {
+    ctl.tbllayout = il;
+    ctl.tblnuma = (il == layout ? numa : 0);
+    tbl[il] = tbl_alloc(&ctl, sizeof(tbl_t), -1);
+    read_tbl(&ctl, tbl[il]);
+  }
+  ctl.tbllayout = layout;
+  ctl.tblnuma = numa;
+
+  /* Open cache miss counters... */
+  for (int il = 0; il < 2; il++)
+    fd[il] = counter_open();
+
+  /* Loop over layouts... */
+  for (int il = 0; il < 2; il++) {
+
+    /* Loop over rays... */
+    for (int ir = 0; ir < obs.nr; ir++) {
+
+      /* Raytracing... */
+      raytrace(&ctl, &atm, &obs, los, ir);
+      if (il == 0)
+	np += los->np;
+
+      /* Interpolate emissivities along the LOS... */
+      const double m0 = counter_read(fd[il]);
+      const double t0 = omp_get_wtime();
+      for (int irep = 0; irep < nrep; irep++) {
+	for (int id = 0; id < ctl.nd; id++)
+	  for (int ig = 0; ig < ctl.ng; ig++)
+	    tau_path[il][ir][id][ig] = 1;
+	for (int ip = 0; ip < los->np; ip++)
+	  if (ctl.formod == 0)
+	    intpol_tbl_cga(&ctl, tbl[il], 0, los, ip, tau_path[il][ir],
+			   tau_seg);
+	  else
+	    intpol_tbl_ega(&ctl, tbl[il], 0, los, ip, tau_path[il][ir],
+			   tau_seg);
+      }
+      dt[il] += omp_get_wtime() - t0;
+      miss[il] += counter_read(fd[il]) - m0;
+    }
+  }
+
+  /* Compare results... */
+  for (int ir = 0; ir < obs.nr; ir++)
+    for (int id = 0; id < ctl.nd; id++)
+      for (int ig = 0; ig < ctl.ng; ig++)
+	dmax = MAX(dmax, fabs(tau_path[1][ir][id][ig]
+			      - tau_path[0][ir][id][ig]));
+
+  /* Write info... */
+  for (int il = 0; il < 2; il++) {
+    const double n = (double) nrep * np;
+    if (fd[il] >= 0) {
+      LOG(1, "Layout %d (%s): %g us and %g cache misses per LOS point", il,
+	  il == 0 ? "channel-outer" : "channel-inner", 1e6 * dt[il] / n,
+	  miss[il] / n);
+    } else {
+      LOG(1, "Layout %d (%s): %g us per LOS point (cache misses n/a)", il,
+	  il == 0 ? "channel-outer" : "channel-inner", 1e6 * dt[il] / n);
+    }
+  }
+  LOG(1, "Speedup of channel-inner layout: %g", dt[0] / dt[1]);
+  LOG(1, "Maximum difference of path transmittance: %g", dmax);
+
+  /* Initialize... */
+  for (int node = 0; node < NNODE; node++) {
+    nthrd[node] = 0;
+    npts[node] = tnode[node] = 0;
+  }
+
+  /* Measure lookup throughput of all threads (pin threads with
+     OMP_PROC_BIND to get stable per-node results)... */
+#pragma omp parallel default(shared)
+  {
+    los_t *los2;
+
+    double tau_path2[ND][NG], tau_seg2[ND], dt2 = 0;
+
+    int np2 = 0;
+
+#ifdef __linux__
+    const int cpu = sched_getcpu();
+#else
+    const int cpu = -1;
+#endif
+    const int node = (cpu >= 0 && cpu < NCPU
+		      ? tbl[layout]->cpunode[cpu] : 0);
+    const int ic = TBLCOPY(tbl[layout]);
+
+    /* Allocate... */
+    ALLOC(los2, los_t, 1);
+
+    /* Loop over rays... */
+    for (int ir = omp_get_thread_num(); ir < obs.nr;
+	 ir += omp_get_num_threads()) {
+
+      /* Raytracing... */
+      raytrace(&ctl, &atm, &obs, los2, ir);
+      np2 += nrep * los2->np;
+
+      /* Interpolate emissivities along the LOS... */
+      const double t0 = omp_get_wtime();
+      for (int irep = 0; irep < nrep; irep++) {
+	for (int id = 0; id < ctl.nd; id++)
+	  for (int ig = 0; ig < ctl.ng; ig++)
+	    tau_path2[id][ig] = 1;
+	for (int ip = 0; ip < los2->np; ip++)
+	  if (ctl.formod == 0)
+	    intpol_tbl_cga(&ctl, tbl[layout], ic, los2, ip, tau_path2,
+			   tau_seg2);
+	  else
+	    intpol_tbl_ega(&ctl, tbl[layout], ic, los2, ip, tau_path2,
+			   tau_seg2);
+      }
+      dt2 += omp_get_wtime() - t0;
+    }
+
+    /* Collect results... */
+#pragma omp critical
+    {
+      nthrd[node]++;
+      npts[node] += np2;
+      tnode[node] += dt2;
+    }
+
+    /* Free... */
+    free(los2);
+  }
+
+  /* Write info... */
+  for (int node = 0; node < NNODE; node++)
+    if (nthrd[node] > 0)
+      LOG(1, "NUMA node %d: threads= %d | %g LOS points/s per thread"
+	  " | %g LOS points/s", node, nthrd[node], npts[node] / tnode[node],
+	  nthrd[node] * npts[node] / tnode[node]);
+
+  /* Free... */
+  free(los);
+  for (int il = 0; il < 2; il++)
+    tbl_free(tbl[il], sizeof(tbl_t));
+
+  return EXIT_SUCCESS;
+}
+
+/*****************************************************************************/
+
+int counter_open(
+  void) {
+
+#ifdef __linux__
+  struct perf_event_attr attr;
+
+  /* Set up counter for last level cache misses of this thread... */
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+/*****************************************************************************/
+
+double counter_read(
+  const int fd) {
+
+  long long count = 0;
+
+  /* Read counter... */
+  if (fd < 0 || read(fd, &count, sizeof(count)) != sizeof(count))
+    return 0;
+
+  return (double) count;
+}
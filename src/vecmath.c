@@ -0,0 +1,88 @@
+/*
+  This file is part of JURASSIC.
+  
+  JURASSIC is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  
+  JURASSIC is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  
+  You should have received a copy of the GNU General Public License
+  along with JURASSIC. If not, see <http://www.gnu.org/licenses/>.
+  
+  Copyright (C) 2003-2025 Forschungszentrum Juelich GmbH
+*/
+
+/*! 
+  \file
+  JURASSIC vector math kernels.
+
+  With VECMATH=1 this file is compiled with -ffast-math, so that glibc's
+  <math.h> declares the SIMD variants of asin(), atan2(), exp(), and
+  expm1() and the loops below are vectorized with libmvec; results then
+  differ from the scalar code at round-off level. Otherwise the kernels
+  reproduce the scalar code exactly.
+*/
+
+#include "jurassic.h"
+
+/*****************************************************************************/
+
+void vec_cart2geo(
+  const int n,
+  const double *x0,
+  const double *x1,
+  const double *x2,
+  double *z,
+  double *lon,
+  double *lat) {
+
+#pragma omp simd
+  for (int i = 0; i < n; i++) {
+    const double radius =
+      sqrt(x0[i] * x0[i] + x1[i] * x1[i] + x2[i] * x2[i]);
+    lat[i] = RAD2DEG(asin(x2[i] / radius));
+    lon[i] = RAD2DEG(atan2(x1[i], x0[i]));
+    z[i] = radius - RE;
+  }
+}
+
+/*****************************************************************************/
+
+double vec_planck(
+  const int n,
+  const double *ff,
+  const double *c1,
+  const double *c2,
+  const double t) {
+
+  double sum = 0;
+
+#ifdef VECMATH
+#pragma omp simd reduction(+:sum)
+  for (int i = 0; i < n; i++)
+    sum += ff[i] * (c1[i] / expm1(c2[i] / t));
+#else
+  for (int i = 0; i < n; i++)
+    sum += ff[i] * (c1[i] / gsl_expm1(c2[i] / t));
+#endif
+
+  return sum;
+}
+
+/*****************************************************************************/
+
+void vec_tau(
+  const int n,
+  const double *beta,
+  const double ds,
+  double *tau) {
+
+#pragma omp simd
+  for (int i = 0; i < n; i++)
+    tau[i] = exp(-beta[i] * ds);
+}
@@ -0,0 +1,28 @@
+#! /bin/bash
+
+# Setup...
+jurassic=../../src
+
+# Create observation geomtry...
+$jurassic/limb limb.ctl obs.tab
+
+# Call forward model (regular 3D grid)...
+$jurassic/formod limb.ctl obs.tab atm.tab rad.tab
+
+# Call forward model (irregular grid, must fail)...
+$jurassic/formod limb.ctl obs.tab atm_irr.tab rad_irr.tab > log_irr.txt
+
+# Call forward model (curtain of profiles, no 3D grid)...
+$jurassic/formod limb.ctl obs.tab atm_irr.tab rad_curtain.tab ATM3D 0 \
+		 > log_curtain.txt
+
+# Compare files...
+echo -e "\nCompare results..."
+error=0
+diff -sq rad.tab rad.org || error=1
+grep -q "must be given on a regular grid" log_irr.txt \
+    && echo "Irregular grid rejected" || error=1
+grep -q "3D grid" log_curtain.txt && error=1
+grep -q "Write observation data" log_curtain.txt \
+    && echo "Curtain accepted" || error=1
+exit $error
@@ -12,6 +12,15 @@ $jurassic/limb limb.ctl obs.tab
 # Call forward model...
 $jurassic/formod limb.ctl obs.tab atm.tab rad.tab TASK time
 
+# Call forward model (spherical shells)...
+$jurassic/formod limb.ctl obs.tab atm.tab rad_shells.tab RAYGEOM 1
+
+# Call forward model (tabulated continua)...
+$jurassic/formod limb.ctl obs.tab atm.tab rad_ctm.tab CTM_TBL 1
+
+# Call forward model (batch ray-tracing)...
+$jurassic/formod limb.ctl obs.tab atm.tab rad_batch.tab RAYBATCH 8
+
 # Compute kernel...
 $jurassic/kernel limb.ctl obs.tab atm.tab kernel.tab
 
@@ -20,4 +29,19 @@ echo -e "\nCompare results..."
 error=0
 diff -sq kernel.tab kernel.org
 diff -sq rad.tab rad.org || error=1
+diff -sq rad_shells.tab rad_shells.org || error=1
+paste rad.tab rad_ctm.tab | awk '!/^#/ && NF {
+    n = NF / 2
+    for (i = 11; i <= n; i++) {
+      d = ($i - $(i + n)) / ($i != 0 ? $i : 1)
+      if (d > 1e-3 || d < -1e-3) bad++
+    }
+  } END {exit (bad > 0)}' || error=1
+paste rad.tab rad_batch.tab | awk '!/^#/ && NF {
+    n = NF / 2
+    for (i = 1; i <= n; i++) {
+      d = ($i - $(i + n)) / ($i != 0 ? $i : 1)
+      if (d > 1e-6 || d < -1e-6) bad++
+    }
+  } END {exit (bad > 0 || NR == 0)}' || error=1
 exit $error
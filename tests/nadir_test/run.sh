@@ -12,6 +12,14 @@ $jurassic/nadir nadir.ctl obs.tab
 # Call forward model...
 $jurassic/formod nadir.ctl obs.tab atm.tab rad.tab TASK time
 
+# Call forward model (nadir layers with spherical correction)...
+$jurassic/formod nadir.ctl obs.tab atm.tab rad_layers.tab RAYGEOM 3
+
+# Call forward model (tabulated continua)...
+$jurassic/formod nadir.ctl obs.tab atm.tab rad_ctm.tab CTM_TBL 1
+$jurassic/formod nadir.ctl obs.tab atm.tab rad_layers_ctm.tab \
+		 CTM_TBL 1 RAYGEOM 3
+
 # Compute kernel...
 $jurassic/kernel nadir.ctl obs.tab atm.tab kernel.tab
 
@@ -20,4 +28,14 @@ echo -e "\nCompare results..."
 error=0
 diff -sq kernel.tab kernel.org
 diff -sq rad.tab rad.org || error=1
+diff -sq rad_layers.tab rad_layers.org || error=1
+for f in rad rad_layers ; do
+    paste $f.tab ${f}_ctm.tab | awk '!/^#/ && NF {
+        n = NF / 2
+        for (i = 11; i <= n; i++) {
+          d = ($i - $(i + n)) / ($i != 0 ? $i : 1)
+          if (d > 1e-3 || d < -1e-3) bad++
+        }
+      } END {exit (NR == 0 || bad > 0)}' || error=1
+done
 exit $error
@@ -0,0 +1,240 @@
+#! /bin/bash
+
+# Setup...
+jurassic=../../src
+
+# Create a priori and true atmospheric data (temperature and ozone
+# perturbations)...
+$jurassic/climatology ret.ctl atm_apr.tab Z0 0 Z1 80 DZ 2
+awk '!/^#/ && NF {$6 += 3 * exp(-(($2 - 25) / 5)^2);
+     $9 *= 1 + 0.2 * exp(-(($2 - 30) / 5)^2)} {print}' \
+    atm_apr.tab > atm_true.tab
+awk '!/^#/ && NF {$6 -= 1 * exp(-(($2 - 35) / 5)^2)} {print}' \
+    atm_true.tab > atm_true2.tab
+
+# Create a priori data with two profiles (3D grid)...
+awk '!/^#/ && NF {$4 = 26} {print}' atm_apr.tab > atm_apr2.tab
+awk '!/^#/ && NF {$4 = 27} {print}' atm_apr.tab >> atm_apr2.tab
+
+# Create a priori data that is not a single profile (one latitude
+# shifted by 1e-6 deg, see single-profile check of cov_apr_invert)...
+awk '!/^#/ && NF && $2 == 20 {$4 = 1e-6} {print}' atm_apr.tab > atm_apr3.tab
+
+# Create observation geometry...
+$jurassic/limb ret.ctl obs.tab Z0 6 Z1 45 DZ 3
+
+# Create measurements...
+$jurassic/formod ret.ctl obs.tab atm_true.tab obs_meas.tab
+$jurassic/formod ret.ctl obs.tab atm_true2.tab obs_meas2.tab
+
+# Set up retrieval directories...
+for dir in tri dense multi; do
+    mkdir -p $dir
+    cp obs_meas.tab $dir/obs_meas.tab
+done
+cp atm_apr.tab tri/atm_apr.tab
+cp atm_apr3.tab dense/atm_apr.tab
+cp atm_apr2.tab multi/atm_apr.tab
+
+# Run retrievals (tridiagonal inverse and dense Cholesky inverse of
+# a priori covariance, single-profile and multi-profile block)...
+for dir in tri dense; do
+    echo $dir > dirlist
+    $jurassic/retrieval ret.ctl dirlist > $dir.log
+done
+echo multi > dirlist
+$jurassic/retrieval ret.ctl dirlist ATM3D 1 > multi.log
+
+# Set up retrieval directories for solver options...
+for dir in eig cg broyden sparse batch/p1 batch/p2 warm/p1 warm/p2; do
+    mkdir -p $dir
+    cp atm_apr.tab $dir/atm_apr.tab
+done
+for dir in eig cg broyden sparse batch/p1 warm/p1; do
+    cp obs_meas.tab $dir/obs_meas.tab
+done
+cp obs_meas2.tab batch/p2/obs_meas.tab
+cp obs_meas2.tab warm/p2/obs_meas.tab
+
+# Run retrievals (solver options)...
+echo eig > dirlist
+$jurassic/retrieval ret.ctl dirlist LM_SOLVER 1 > eig.log
+echo cg > dirlist
+$jurassic/retrieval ret.ctl dirlist LM_SOLVER 2 > cg.log
+echo broyden > dirlist
+$jurassic/retrieval ret.ctl dirlist KERNEL_BROYDEN 1 > broyden.log
+echo sparse > dirlist
+$jurassic/retrieval ret.ctl dirlist KERNEL_SPARSE 1 > sparse.log
+echo -e "batch/p1\nbatch/p2" > dirlist
+$jurassic/retrieval ret.ctl dirlist RET_BATCH 2 > batch.log
+echo -e "warm/p1\nwarm/p2" > dirlist
+$jurassic/retrieval ret.ctl dirlist RET_WARM 2 > warm.log
+
+# Set up retrieval directories for stale kernel matrix (rejected
+# Levenberg-Marquardt steps)...
+for dir in stale/chol stale/eig stale/broyden; do
+    mkdir -p $dir
+    cp atm_apr.tab $dir/atm_apr.tab
+    cp obs_meas2.tab $dir/obs_meas.tab
+done
+
+# Run retrievals with stale kernel matrix...
+echo stale/chol > dirlist
+$jurassic/retrieval ret.ctl dirlist KERNEL_RECOMP 50 > stale_chol.log
+echo stale/eig > dirlist
+$jurassic/retrieval ret.ctl dirlist KERNEL_RECOMP 50 LM_SOLVER 1 \
+	       > stale_eig.log
+echo stale/broyden > dirlist
+$jurassic/retrieval ret.ctl dirlist KERNEL_RECOMP 50 KERNEL_BROYDEN 1 \
+	       > stale_broyden.log
+
+# Run retrieval with matrix output (full a priori covariance is
+# written, tridiagonal inverse is used)...
+mkdir -p matrix
+cp atm_apr.tab obs_meas.tab matrix
+echo matrix > dirlist
+$jurassic/retrieval ret.ctl dirlist WRITE_MATRIX 1 > matrix.log
+
+# Run retrieval with sparse kernel matrix output...
+mkdir -p matrix_sparse
+cp atm_apr.tab obs_meas.tab matrix_sparse
+echo matrix_sparse > dirlist
+$jurassic/retrieval ret.ctl dirlist WRITE_MATRIX 1 KERNEL_SPARSE 1 \
+	       > matrix_sparse.log
+
+# Set up retrieval directories for speculative trial steps...
+for dir in nspec/p1 nspec/p2 nspec/cg nspec/eig; do
+    mkdir -p $dir
+    cp atm_apr.tab obs_meas.tab $dir
+done
+
+# Run retrievals with speculative trial steps (nested in concurrent
+# retrievals, more threads than trials)...
+echo -e "nspec/p1\nnspec/p2" > dirlist
+OMP_NUM_THREADS=6 $jurassic/retrieval ret.ctl dirlist RET_NPROF 2 \
+	       LM_NSPEC 3 > nspec.log
+echo nspec/cg > dirlist
+OMP_NUM_THREADS=6 $jurassic/retrieval ret.ctl dirlist LM_SOLVER 2 \
+	       LM_NSPEC 3 > nspec_cg.log
+echo nspec/eig > dirlist
+OMP_NUM_THREADS=6 $jurassic/retrieval ret.ctl dirlist LM_SOLVER 1 \
+	       LM_NSPEC 3 > nspec_eig.log
+
+# Set up retrieval directories for many observations (dense and
+# sparse matrix products, dense ones in more than one block)...
+$jurassic/climatology ret.ctl atm_apr4.tab Z0 0 Z1 80 DZ 1
+awk '!/^#/ && NF {$6 += 3 * exp(-(($2 - 25) / 5)^2);
+     $9 *= 1 + 0.2 * exp(-(($2 - 30) / 5)^2)} {print}' \
+    atm_apr4.tab > atm_true4.tab
+$jurassic/limb ret.ctl obs4.tab Z0 6 Z1 45 DZ 0.155
+$jurassic/formod ret.ctl obs4.tab atm_true4.tab obs_meas4.tab \
+		 RAYDS 20 RAYDZ 1
+for dir in blocks/dense blocks/sparse; do
+    mkdir -p $dir
+    cp atm_apr4.tab $dir/atm_apr.tab
+    cp obs_meas4.tab $dir/obs_meas.tab
+done
+
+# Run retrievals with many observations...
+echo blocks/dense > dirlist
+$jurassic/retrieval ret.ctl dirlist RAYDS 20 RAYDZ 1 > blocks_dense.log
+echo blocks/sparse > dirlist
+$jurassic/retrieval ret.ctl dirlist RAYDS 20 RAYDZ 1 \
+	       KERNEL_SPARSE 1 > blocks_sparse.log
+
+# Set up retrieval directories for concurrent retrievals (the last
+# one was started but did not finish in a previous run)...
+for dir in resume/p1 resume/p2 resume/p3; do
+    mkdir -p $dir
+    cp atm_apr.tab obs_meas.tab $dir
+done
+echo "0 0" > resume/p3/ret_status.tab
+
+# Run retrievals concurrently and run again with completed
+# directories...
+echo -e "resume/p1\nresume/p2\nresume/p3" > dirlist
+$jurassic/retrieval ret.ctl dirlist RET_NPROF 2 RET_RESUME 1 > resume.log
+$jurassic/retrieval ret.ctl dirlist RET_NPROF 2 RET_RESUME 1 > resume2.log
+
+# Compare files...
+echo -e "\nCompare results..."
+error=0
+grep -q "tridiagonal inverse for 37 of 37" tri.log || error=1
+grep -q "tridiagonal inverse for 0 of 37" dense.log || error=1
+grep -q "tridiagonal inverse for 0 of 74" multi.log || error=1
+grep -q "sparse Cholesky factor with 72 non-zeros" cg.log || error=1
+for dir in dense eig cg broyden sparse batch/p1 warm/p1 warm/p2; do
+    ref=tri
+    [ $dir = warm/p2 ] && ref=batch/p2
+    paste $ref/atm_final.tab $dir/atm_final.tab | awk '!/^#/ && NF {
+        n = NF / 2
+        for (i = 5; i <= n; i++) {
+          d = ($i - $(i + n)) / ($i != 0 ? $i : 1)
+          if (d > 1e-5 || d < -1e-5) bad++
+        }
+      } END {exit (NR == 0 || bad > 0)}' || error=1
+done
+diff -sq tri/atm_final.tab tri/atm_final.org || error=1
+diff -sq multi/atm_final.tab multi/atm_final.org || error=1
+for dir in eig cg broyden sparse batch/p1 batch/p2 warm/p1 warm/p2; do
+    diff -sq $dir/atm_final.tab $dir/atm_final.org || error=1
+done
+paste stale/chol/atm_final.tab stale/eig/atm_final.tab | awk '!/^#/ && NF {
+    n = NF / 2
+    for (i = 5; i <= n; i++) {
+      d = ($i - $(i + n)) / ($i != 0 ? $i : 1)
+      if (d > 1e-5 || d < -1e-5) bad++
+    }
+  } END {exit (NR == 0 || bad > 0)}' || error=1
+grep -q "full computations= 2 / Broyden updates= 3" stale_broyden.log \
+    || error=1
+paste batch/p2/atm_final.tab stale/broyden/atm_final.tab | awk '!/^#/ && NF {
+    n = NF / 2
+    for (i = 5; i <= n; i++) {
+      d = ($i - $(i + n)) / ($i != 0 ? $i : 1)
+      if (d > 1e-5 || d < -1e-5) bad++
+    }
+  } END {exit (NR == 0 || bad > 0)}' || error=1
+grep -q "tridiagonal inverse for 37 of 37" matrix.log || error=1
+diff -sq matrix/atm_final.tab tri/atm_final.org || error=1
+awk '!/^#/ && NF && $1 != $7 && $13 != 0 {n++} END {exit (n == 0)}' \
+    matrix/matrix_cov_apr.tab || error=1
+awk 'FNR == NR {
+    if (!/^#/ && NF) {k[$1, $7] = $13; nnz++}
+    next
+  } !/^#/ && NF {
+    a = ($13 < 0 ? -$13 : $13)
+    if (a > kmax) kmax = a
+    if (($1, $7) in k) {
+      d = (k[$1, $7] - $13) / $13
+      if (d > 1e-2 || d < -1e-2) bad++
+    } else if (a > dmax) dmax = a
+  } END {exit (nnz == 0 || bad > 0 || dmax > 1e-5 * kmax)}' \
+    matrix_sparse/matrix_kernel.tab matrix/matrix_kernel.tab || error=1
+for dir in nspec/p1 nspec/p2 nspec/cg nspec/eig; do
+    paste tri/atm_final.tab $dir/atm_final.tab | awk '!/^#/ && NF {
+        n = NF / 2
+        for (i = 5; i <= n; i++) {
+          d = ($i - $(i + n)) / ($i != 0 ? $i : 1)
+          if (d > 1e-5 || d < -1e-5) bad++
+        }
+      } END {exit (NR == 0 || bad > 0)}' || error=1
+done
+grep -q "Problem size: m= 504 / n= 72" blocks_dense.log || error=1
+for f in atm_final atm_err_total; do
+    paste blocks/dense/$f.tab blocks/sparse/$f.tab | awk '!/^#/ && NF {
+        n = NF / 2
+        for (i = 5; i <= n; i++) {
+          d = ($i - $(i + n)) / ($i != 0 ? $i : 1)
+          if (d > 1e-5 || d < -1e-5) bad++
+        }
+      } END {exit (NR == 0 || bad > 0)}' || error=1
+done
+grep -q "Retrieved profiles: 2 (skipped: 0 done / 1 not finished)" \
+    resume.log || error=1
+grep -q "Retrieved profiles: 0 (skipped: 2 done / 1 not finished)" \
+    resume2.log || error=1
+diff -sq resume/p1/atm_final.tab tri/atm_final.org || error=1
+diff -sq resume/p2/atm_final.tab tri/atm_final.org || error=1
+test ! -e resume/p3/atm_final.tab || error=1
+exit $error
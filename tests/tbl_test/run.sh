@@ -0,0 +1,196 @@
+#! /bin/bash
+
+# Setup...
+jurassic=../../src
+
+# Create synthetic emissivity look-up tables (same grids for all
+# channels in boxcar, another temperature grid for one channel in
+# grid)...
+for base in boxcar grid ; do
+    for nu in 792.0000 832.0000 ; do
+	for gas in CO2 O3 ; do
+	    t0=160
+	    [ $base$nu$gas = grid832.0000CO2 ] && t0=155
+	    awk -v nu=$nu -v gas=$gas -v t0=$t0 'BEGIN {
+		s = (gas == "CO2" ? 1e-23 : 1e-20) * (nu < 800 ? 1.0 : 1.3)
+		print "# $1 = pressure [hPa]"
+		print "# $2 = temperature [K]"
+		print "# $3 = column density [molecules/cm^2]"
+		print "# $4 = emissivity"
+		for (ip = 0; ip < 36; ip++) {
+		    p = 10^(3.05 - 0.2 * ip)
+		    for (it = 0; it < 13; it++) {
+			t = t0 + 15 * it
+			g = (p / 100)^0.1 * (250 / t)^0.5
+			print ""
+			for (iu = 0; iu < 40; iu++) {
+			    u = 10^(log(1e-6 / s) / log(10) + iu * 7 / 39)
+			    eps = 1 - exp(-(s * u)^0.8 * g)
+			    if (eps > 0.99995)
+				break
+			    printf "%g %g %e %e\n", p, t, u, eps
+			}
+		    }
+		}
+	    }' > ${base}_${nu}_${gas}.tab
+	done
+	[ $base = grid ] && cp boxcar_$nu.filt grid_$nu.filt
+    done
+done
+
+# Create atmospheric data file...
+$jurassic/climatology tbl.ctl atm.tab
+
+# Create observation geomtry...
+$jurassic/limb tbl.ctl obs.tab
+
+# Call forward model...
+$jurassic/formod tbl.ctl obs.tab atm.tab rad.tab
+
+# Call forward model (huge pages and NUMA interleaving)...
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_huge.tab \
+		 TBLHUGE 1 TBLNUMA 1
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_hugetlb.tab \
+		 TBLHUGE 2 TBLNUMA 1
+
+# Call forward model (channel-inner layout)...
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_layout.tab TBLLAYOUT 1
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_cga.tab FORMOD 0
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_cga_layout.tab \
+		 FORMOD 0 TBLLAYOUT 1
+
+# Call forward model (emitter without tables, skipped pairs)...
+$jurassic/climatology tbl.ctl atm_skip.tab NG 3 EMITTER[2] H2O
+$jurassic/formod tbl.ctl obs.tab atm_skip.tab rad_skip.tab \
+		 NG 3 EMITTER[2] H2O CTM_H2O 0 > log_skip.txt
+$jurassic/formod tbl.ctl obs.tab atm_skip.tab rad_skip_cga.tab \
+		 NG 3 EMITTER[2] H2O CTM_H2O 0 FORMOD 0 > log_skip_cga.txt
+
+# Call forward model (channels with different table grids, all
+# channels and single channel)...
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_grid.tab \
+		 TBLBASE ./grid > log_grid.txt
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_grid_832.tab \
+		 TBLBASE ./grid ND 1 NU[0] 832.0000
+
+# Convert tables (channel-inner layout) and call forward model...
+$jurassic/tblfmt tbl.ctl ./boxcar 1 ./boxcar 2 TBLLAYOUT 1
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_bin.tab \
+		 TBLFMT 2
+
+# Call forward model (quantised tables)...
+for qerr in 1e-3 1e-4 ; do
+    $jurassic/formod tbl.ctl obs.tab atm.tab rad_quant_$qerr.tab \
+		     TBLQUANT 1 TBLQERR $qerr > log_quant_$qerr.txt
+done
+
+# Call forward model (NUMA replicated tables)...
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_numa.tab \
+		 TBLLAYOUT 1 TBLNUMA 2
+
+# Call forward model (source function cache: miss, partial, hit)...
+rm -f srcfunc.bin
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_src_miss.tab \
+		 SRCCACHE srcfunc.bin ND 1 > log_src_miss.txt
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_src_part.tab \
+		 SRCCACHE srcfunc.bin > log_src_part.txt
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_src_hit.tab \
+		 SRCCACHE srcfunc.bin > log_src_hit.txt
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_src_other.tab \
+		 SRCCACHE srcfunc.bin ND 1 NU[0] 832.0000 > log_src_other.txt
+
+# Call forward model (source function cache with wrong version,
+# rewritten cache holds header of 32 bytes, then hash and 1200 values
+# of source function for each channel)...
+printf '\x00\x00\x00\x00' | dd of=srcfunc.bin bs=1 seek=4 conv=notrunc \
+				 2> /dev/null
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_src_version.tab \
+		 SRCCACHE srcfunc.bin > log_src_version.txt
+
+# Call forward model (shared-memory tables: create, attach, stale)...
+shm=/jurassic_tbl_test_$$
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_shm_create.tab \
+		 TBLSHM $shm TBLHUGE 1 > log_shm_create.txt
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_shm_attach.tab \
+		 TBLSHM $shm > log_shm_attach.txt
+touch boxcar_792.0000.filt
+$jurassic/formod tbl.ctl obs.tab atm.tab rad_shm_stale.tab \
+		 TBLSHM $shm > log_shm_stale.txt
+rm -f /dev/shm$shm
+
+# Compare files...
+echo -e "\nCompare results..."
+error=0
+diff -sq rad.tab rad.org || error=1
+diff -sq rad_huge.tab rad.tab || error=1
+diff -sq rad_hugetlb.tab rad.tab || error=1
+diff -sq rad_numa.tab rad.tab || error=1
+diff -sq rad_layout.tab rad.tab || error=1
+diff -sq rad_cga_layout.tab rad_cga.tab || error=1
+diff -sq rad_bin.tab rad.tab || error=1
+grep -q "Emitter CO2 is active in 2 of 2 channels (2 table grids)" \
+    log_grid.txt || error=1
+paste <(grep -v "^#" rad.tab) <(grep -v "^#" rad_grid.tab) \
+      <(grep -v "^#" rad_grid_832.tab) | awk 'NF {
+    if ($11 != $25 || $13 != $27 || $26 != $39 || $28 != $40) bad++
+  } END {exit (NR == 0 || bad > 0)}' || error=1
+grep -q "Emitter H2O is active in 0 of 2 channels" log_skip.txt || error=1
+grep -q "pairs: 4 of 6 (33.3% skipped)" log_skip.txt || error=1
+diff -sq rad_skip.tab rad.tab || error=1
+diff -sq rad_skip_cga.tab rad_cga.tab || error=1
+grep -q "Cache not found" log_src_miss.txt || error=1
+grep -q "cached channels: 1 of 2" log_src_part.txt || error=1
+grep -q "cached channels: 2 of 2" log_src_hit.txt || error=1
+grep -q "cached channels: 1 of 1" log_src_other.txt || error=1
+grep -q "wrong format or version" log_src_version.txt || error=1
+grep -q "ignored for the shared-memory segment" log_shm_create.txt || error=1
+grep -q "Create segment" log_shm_create.txt || error=1
+grep -q "Attach to segment" log_shm_attach.txt || error=1
+grep -q "do not match the configuration" log_shm_stale.txt || error=1
+for f in create attach stale ; do
+    diff -sq rad_shm_$f.tab rad.tab || error=1
+done
+for f in part hit version ; do
+    diff -sq rad_src_$f.tab rad.tab || error=1
+done
+skip=40
+for nu in 792.0000 832.0000 ; do
+    od -A n -v -t f8 -j $skip -N 9600 srcfunc.bin \
+	| awk 'BEGIN {n = ns = 0} NR == FNR {
+        if (!/^#/ && NF) {nu[n] = $1; f[n++] = $2}
+        next
+      } {
+        for (i = 1; i <= NF; i++) sr[ns++] = $i
+      } END {
+        for (it = 0; it < ns; it++) {
+          t = 100 + 300 * it / (ns - 1)
+          s = fs = 0
+          for (i = 0; i < n; i++) {
+            s += f[i] * 1.19104259e-8 * nu[i]^3 \
+              / (exp(1.43877506 * nu[i] / t) - 1)
+            fs += f[i]
+          }
+          d = (sr[it] - s / fs) / sr[it]
+          if (d > 1e-6 || d < -1e-6) bad++
+        }
+        exit (ns != 1200 || bad > 0)
+      }' boxcar_$nu.filt - || error=1
+    skip=$((skip + 9608))
+done
+for qerr in 1e-3 1e-4 ; do
+    awk '/Quantised curves/ {
+        n++
+        split($0, a, "maximum error= ")
+        split($0, b, "bound= ")
+        if (a[2] + 0 > b[2] + 0) bad++
+      } END {exit (n == 0 || bad > 0)}' log_quant_$qerr.txt || error=1
+done
+paste rad.tab rad_quant_1e-4.tab | awk '!/^#/ && NF {
+    n = NF / 2
+    for (i = 11; i <= n; i++) {
+      d = $i - $(i + n)
+      tol = (i <= 10 + (n - 10) / 2 ? 1e-4 : 1e-3)
+      if (d > tol || d < -tol) bad++
+    }
+  } END {exit (bad > 0)}' || error=1
+exit $error